@@ -0,0 +1,181 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Reusable per thread scratch memory of the query paths.
+ *
+ * Counting, listing and sampling need a few large work areas (transition
+ * and rank tables, pattern batches) for the duration of a query. Instead of
+ * a malloc/free pair for each of them every query takes them from the
+ * scratch arena of its thread and resets the arena when it is done. The
+ * first query sizes the arena from what the active grid actually needs,
+ * after that the query paths run without touching the heap. Every heap
+ * allocation of the arenas is counted, so this can be checked (-V).
+ */
+
+#include <stdlib.h>
+
+#include "arena.h"
+#include "parallel.h"
+
+/* Smallest block an arena allocates */
+#define ARENA_MIN_BLOCK (64 * 1024)
+
+/* Scratch arena of every worker thread */
+static struct scratch_arena arenas[MAX_THREADS];
+
+/* Heap allocations of all arenas, and their number at the last reset */
+static unsigned long heap_allocations;
+static unsigned long reset_allocations;
+static unsigned long query_count;
+static unsigned long last_query_allocations;
+
+/*
+ * Scratch arena of a worker thread
+ *
+ * \param thread_index index of the thread (0 for the main thread)
+ * \return the arena, only to be used by the given thread
+ */
+struct scratch_arena *scratch_arena(const int thread_index)
+{
+    return &arenas[thread_index];
+}
+
+/*
+ * Add a heap block of at least a given size to an arena
+ */
+static int arena_grow(struct scratch_arena *arena, const size_t size)
+{
+    size_t block_size = arena->capacity > ARENA_MIN_BLOCK ?
+                        arena->capacity : ARENA_MIN_BLOCK;
+    char *block;
+
+    if (arena->block_count == ARENA_MAX_BLOCKS) {
+        return -1;
+    }
+    while (block_size < size) {
+        block_size *= 2;
+    }
+
+    block = aligned_alloc(ARENA_ALIGNMENT, block_size);
+    if (block == NULL) {
+        return -1;
+    }
+    __atomic_add_fetch(&heap_allocations, 1, __ATOMIC_RELAXED);
+
+    arena->blocks[arena->block_count] = block;
+    arena->block_size[arena->block_count] = block_size;
+    arena->block_count++;
+    arena->capacity += block_size;
+    arena->used = 0;
+
+    return 0;
+}
+
+/*
+ * Allocate scratch memory, valid until the arena is reset
+ *
+ * \param arena arena of the calling thread
+ * \param size number of bytes
+ * \return memory aligned to ARENA_ALIGNMENT, NULL if out of memory
+ */
+void *arena_alloc(struct scratch_arena *arena, const size_t size)
+{
+    size_t aligned = (size + ARENA_ALIGNMENT - 1) &
+                     ~(size_t)(ARENA_ALIGNMENT - 1);
+    char *p;
+
+    if (arena->block_count == 0 ||
+        arena->used + aligned > arena->block_size[arena->block_count - 1])
+    {
+        if (arena_grow(arena, aligned) < 0) {
+            return NULL;
+        }
+    }
+
+    p = arena->blocks[arena->block_count - 1] + arena->used;
+    arena->used += aligned;
+    arena->in_use += aligned;
+    if (arena->in_use > arena->high_water) {
+        arena->high_water = arena->in_use;
+    }
+
+    return p;
+}
+
+/*
+ * Release every allocation of a query. An arena which grew is merged into
+ * one block large enough for the whole query.
+ *
+ * \param arena arena of the calling thread
+ */
+void arena_reset(struct scratch_arena *arena)
+{
+    size_t capacity = arena->capacity;
+    unsigned long allocations;
+
+    if (arena->block_count > 1) {
+        arena_free(arena);
+        arena_grow(arena, capacity);
+    }
+    arena->used = 0;
+    arena->in_use = 0;
+
+    /* attribute the heap allocations since the last reset to this query,
+     * exact as long as only one thread runs queries at a time */
+    allocations = __atomic_load_n(&heap_allocations, __ATOMIC_RELAXED);
+    allocations -= __atomic_exchange_n(&reset_allocations, allocations,
+                                       __ATOMIC_RELAXED);
+    __atomic_store_n(&last_query_allocations, allocations, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&query_count, 1, __ATOMIC_RELAXED);
+
+    return;
+}
+
+/*
+ * Return the blocks of an arena to the heap
+ *
+ * \param arena arena to free
+ */
+void arena_free(struct scratch_arena *arena)
+{
+    int i;
+
+    for (i = 0; i < arena->block_count; i++) {
+        free(arena->blocks[i]);
+    }
+    arena->block_count = 0;
+    arena->capacity = 0;
+    arena->used = 0;
+    arena->in_use = 0;
+
+    return;
+}
+
+/*
+ * Collect the heap use of the arenas
+ *
+ * \param stats statistics to fill
+ */
+void get_arena_stats(struct arena_stats *stats)
+{
+    int i;
+
+    stats->queries = __atomic_load_n(&query_count, __ATOMIC_RELAXED);
+    stats->heap_allocations = __atomic_load_n(&heap_allocations,
+                                              __ATOMIC_RELAXED);
+    stats->last_query_allocations = __atomic_load_n(&last_query_allocations,
+                                                    __ATOMIC_RELAXED);
+    stats->high_water = 0;
+    for (i = 0; i < MAX_THREADS; i++) {
+        if (arenas[i].high_water > stats->high_water) {
+            stats->high_water = arenas[i].high_water;
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,52 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Reusable per thread scratch memory of the query paths.
+ */
+
+#ifndef AUPATTERNS_ARENA_H
+#define AUPATTERNS_ARENA_H
+
+#include <stddef.h>
+
+/* Alignment of every scratch allocation (a cache line) */
+#define ARENA_ALIGNMENT 64
+
+/* Largest number of blocks an arena grows by before it is reset */
+#define ARENA_MAX_BLOCKS 16
+
+/*
+ * Bump allocator. Allocations live until the arena is reset. An arena that
+ * had to grow during a query is merged into a single block on reset, so the
+ * next query of the same size allocates nothing from the heap.
+ */
+struct scratch_arena {
+    int block_count;
+    char *blocks[ARENA_MAX_BLOCKS];
+    size_t block_size[ARENA_MAX_BLOCKS];
+    size_t used;
+    size_t in_use;
+    size_t capacity;
+    size_t high_water;
+};
+
+/* Heap use of all arenas */
+struct arena_stats {
+    unsigned long queries;
+    unsigned long heap_allocations;
+    unsigned long last_query_allocations;
+    size_t high_water;
+};
+
+struct scratch_arena *scratch_arena(const int thread_index);
+void *arena_alloc(struct scratch_arena *arena, const size_t size);
+void arena_reset(struct scratch_arena *arena);
+void arena_free(struct scratch_arena *arena);
+void get_arena_stats(struct arena_stats *stats);
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Benchmark of the generators of the complete and near complete patterns.
+ * Every generator produces the patterns of one length of the standard grid
+ * a number of times, and the best run is reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hamilton.h"
+
+/* Default number of runs of every generator */
+#define BENCH_RUNS 20
+
+/* Patterns seen by a generator, hashed in order so the work cannot be
+ * optimized out and the generators can be compared */
+struct bench_sink {
+    int length;
+    size_t count;
+    packed_pattern_t checksum;
+};
+
+/*
+ * Fold a pattern into an order dependent checksum
+ */
+static packed_pattern_t fold(const packed_pattern_t checksum,
+                             const packed_pattern_t pattern)
+{
+    return (checksum ^ pattern) * 0x100000001b3ULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * General enumerator, keeping the patterns of the target length
+ */
+static void sink_visit(void *ctx, const packed_pattern_t pattern,
+                       const unsigned int used_mask)
+{
+    struct bench_sink *sink = ctx;
+
+    if (popcount_mask(used_mask) == sink->length) {
+        sink->count++;
+        sink->checksum = fold(sink->checksum, pattern);
+    }
+
+    return;
+}
+
+/*
+ * Complete length generator
+ */
+static void sink_flush(void *ctx, const packed_pattern_t *patterns,
+                       const size_t count)
+{
+    struct bench_sink *sink = ctx;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        sink->checksum = fold(sink->checksum, patterns[i]);
+    }
+    sink->count += count;
+
+    return;
+}
+
+/*
+ * Run the generators for one length and print their best times
+ */
+static void bench_length(const struct order_table *order, const int length,
+                         const int runs)
+{
+    static const char *names[] = { "enumerate_from", "next_pattern",
+                                   "hamilton" };
+    struct hamilton_table *table;
+    packed_pattern_t buffer[HAMILTON_BUFFER_SIZE];
+    int generator, run;
+
+    table = malloc(sizeof(struct hamilton_table));
+    if (table == NULL) {
+        fprintf(stderr, "Not enough memory for the benchmark!\n");
+        return;
+    }
+
+    for (generator = 0; generator < 3; generator++) {
+        struct bench_sink sink;
+        double best = 0;
+
+        for (run = 0; run < runs; run++) {
+            packed_pattern_t pattern;
+            int prefix_length = 0;
+            double start = now();
+            double elapsed;
+
+            sink.length = length;
+            sink.count = 0;
+            sink.checksum = 0;
+
+            if (generator == 0) {
+                enumerate_from(&order->transitions, 0, length, sink_visit,
+                               &sink);
+            } else if (generator == 1) {
+                for (pattern = first_pattern(order, length);
+                     pattern != 0 && packed_length(pattern) == length;
+                     pattern = next_pattern(order, pattern, &prefix_length))
+                {
+                    sink.count++;
+                    sink.checksum = fold(sink.checksum, pattern);
+                }
+            } else {
+                /* the table is part of the work, it depends on the length */
+                build_hamilton_table(order, length, table);
+                enumerate_hamilton(table, buffer, sink_flush, &sink);
+            }
+
+            elapsed = now() - start;
+            if (run == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+
+        printf("length %d %-15s %8lu patterns %9.3f ms %7.2f ns/pattern "
+               "(checksum %016llx)\n", length, names[generator],
+               (unsigned long)sink.count, best * 1e3,
+               sink.count > 0 ? best * 1e9 / sink.count : 0.0,
+               (unsigned long long)sink.checksum);
+    }
+
+    free(table);
+
+    return;
+}
+
+int main(int argc, char *argv[])
+{
+    struct order_table *order;
+    int runs = BENCH_RUNS;
+    int length;
+
+    if (argc > 2 || (argc == 2 && (runs = atoi(argv[1])) < 1)) {
+        fprintf(stderr, "Usage: %s [RUNS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    order = malloc(sizeof(struct order_table));
+    if (order == NULL) {
+        fprintf(stderr, "Not enough memory for the order table!\n");
+        return EXIT_FAILURE;
+    }
+    build_order_table(pattern_block_matrix, order);
+
+    for (length = HAMILTON_MIN_LENGTH; length <= MAX_POINTS; length++) {
+        bench_length(order, length, runs);
+    }
+
+    free(order);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern output partitioned into one file per used dot set.
+ *
+ * Analysts want the patterns of every dot choice separately, which used to
+ * take one -g run per subset. Here a single enumeration routes each pattern
+ * by its used dot set into one of MASK_COUNT buckets. Every bucket has its
+ * own slice of one BUCKET_MEMORY_BUDGET sized buffer and its file is only
+ * opened while a full slice is flushed, so neither memory nor the number of
+ * open files grows with the number of buckets.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bucket.h"
+#include "probes.h"
+
+/*
+ * Append the buffer of a bucket to its file, the first flush truncates
+ */
+static void flush_bucket(struct bucket_writer *writer,
+                         const unsigned int mask)
+{
+    char path[PATH_MAX];
+    char dots[MAX_POINTS + 1];
+    FILE *file;
+
+    if (writer->fill[mask] == 0) {
+        return;
+    }
+
+    AUP_PROBE2(bucket_flush, mask, writer->fill[mask]);
+    mask_to_string(mask, dots);
+    snprintf(path, sizeof(path), "%s/%s.txt", writer->directory, dots);
+    file = fopen(path, writer->created[mask] ? "a" : "w");
+    if (file == NULL) {
+        writer->errors++;
+    } else {
+        if (fwrite(writer->buffers + (size_t)mask * BUCKET_BUFFER_SIZE, 1,
+                   writer->fill[mask], file) != writer->fill[mask])
+        {
+            writer->errors++;
+        }
+        fclose(file);
+    }
+
+    writer->created[mask] = 1;
+    writer->fill[mask] = 0;
+    writer->flushes++;
+
+    return;
+}
+
+static void bucket_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct bucket_writer *writer = ctx;
+    char line[FORMATTED_LINE_SIZE];
+    size_t i, len;
+
+    for (i = 0; i < batch->count; i++) {
+        unsigned int mask = batch->used[i];
+
+        if (pattern_filter_match(writer->filter, batch->patterns[i]) == 0) {
+            continue;
+        }
+
+        len = format_pattern_line(batch, i, line);
+        if (writer->fill[mask] + len > BUCKET_BUFFER_SIZE) {
+            flush_bucket(writer, mask);
+        }
+        memcpy(writer->buffers + (size_t)mask * BUCKET_BUFFER_SIZE +
+               writer->fill[mask], line, len);
+        writer->fill[mask] += (uint16_t)len;
+        writer->count[mask]++;
+    }
+
+    return;
+}
+
+/*
+ * Flush every bucket and write the index of the non-empty ones
+ */
+static void finish_buckets(void *ctx)
+{
+    struct bucket_writer *writer = ctx;
+    char path[PATH_MAX];
+    char dots[MAX_POINTS + 1];
+    FILE *index;
+    unsigned int mask;
+
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        flush_bucket(writer, mask);
+    }
+    free(writer->buffers);
+    writer->buffers = NULL;
+
+    snprintf(path, sizeof(path), "%s/index.txt", writer->directory);
+    index = fopen(path, "w");
+    if (index == NULL) {
+        writer->errors++;
+        return;
+    }
+    for (mask = 1; mask < MASK_COUNT; mask++) {
+        if (writer->count[mask] > 0) {
+            mask_to_string(mask, dots);
+            fprintf(index, "%s %lu\n", dots,
+                    (unsigned long)writer->count[mask]);
+        }
+    }
+    fclose(index);
+
+    return;
+}
+
+/*
+ * Register a visitor writing the patterns (and digests) into one file per
+ * used dot set. The directory is created if it does not exist.
+ *
+ * \param pipeline pipeline to add to
+ * \param writer output directory and filter of the patterns to write
+ * \return returns 0 on success, -1 if the directory or the buffers could
+ *         not be created or the pipeline is full
+ */
+int add_bucket_writer(struct visitor_pipeline *pipeline,
+                      struct bucket_writer *writer)
+{
+    struct pattern_visitor visitor;
+
+    writer->flushes = 0;
+    writer->errors = 0;
+    if (mkdir(writer->directory, 0777) < 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    writer->buffers = malloc(BUCKET_MEMORY_BUDGET);
+    if (writer->buffers == NULL) {
+        return -1;
+    }
+    memset(writer->fill, 0, sizeof(writer->fill));
+    memset(writer->count, 0, sizeof(writer->count));
+    memset(writer->created, 0, sizeof(writer->created));
+
+    visitor.visit_batch = bucket_batch;
+    visitor.finish = finish_buckets;
+    visitor.ctx = writer;
+
+    if (add_pattern_visitor(pipeline, &visitor) < 0) {
+        free(writer->buffers);
+        writer->buffers = NULL;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern output partitioned into one file per used dot set.
+ */
+
+#ifndef AUPATTERNS_BUCKET_H
+#define AUPATTERNS_BUCKET_H
+
+#include <stdint.h>
+
+#include "visitor.h"
+
+/* Memory used by the buffers of all buckets together */
+#define BUCKET_MEMORY_BUDGET (1 << 20)
+
+/* Buffer size of a single bucket */
+#define BUCKET_BUFFER_SIZE (BUCKET_MEMORY_BUDGET / MASK_COUNT)
+
+/*
+ * Writes every pattern into the file of its used dot set (eg.: DIR/1235.txt)
+ * and an index of the pattern count of every set into DIR/index.txt
+ */
+struct bucket_writer {
+    const char *directory;
+    const struct pattern_filter *filter;
+    char *buffers;
+    uint16_t fill[MASK_COUNT];
+    uint32_t count[MASK_COUNT];
+    unsigned char created[MASK_COUNT];
+    unsigned long flushes;
+    int errors;
+};
+
+int add_bucket_writer(struct visitor_pipeline *pipeline,
+                      struct bucket_writer *writer);
+
+#endif
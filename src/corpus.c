@@ -0,0 +1,289 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Frequency analysis of corpora of observed patterns.
+ *
+ * The corpus is mapped into memory and cut into one chunk per thread at line
+ * boundaries. Every thread validates and ranks the patterns of its chunk and
+ * counts them in its own array indexed by rank, so the hot loop shares
+ * nothing. The per thread arrays are summed in parallel over rank ranges at
+ * the end. With the counts indexed by rank every further question (top
+ * patterns, guessing coverage, lengths) is a scan of at most
+ * embedded_pattern_count entries, no matter how large the corpus is.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "corpus.h"
+#include "parallel.h"
+#include "probes.h"
+
+/* Shared state of the counting and merging workers */
+struct corpus_scan {
+    const char *data;
+    size_t size;
+    int thread_count;
+    struct corpus_stats *stats;
+    uint32_t *counts;
+    uint64_t lines[MAX_THREADS];
+    uint64_t invalid[MAX_THREADS];
+    uint64_t length_lines[MAX_THREADS][MAX_POINTS + 1];
+};
+
+/*
+ * First line starting at or after an offset
+ */
+static size_t line_boundary(const struct corpus_scan *scan, size_t offset)
+{
+    while (offset > 0 && offset < scan->size &&
+           scan->data[offset - 1] != '\n')
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+/*
+ * Count the lines starting in the chunk of one thread
+ */
+static void count_worker(void *ctx, const int thread_index)
+{
+    struct corpus_scan *scan = ctx;
+    const struct rank_table *table = scan->stats->table;
+    uint32_t *counts = scan->counts +
+                       (size_t)thread_index * scan->stats->pattern_count;
+    size_t pos = line_boundary(scan, scan->size / scan->thread_count *
+                                     thread_index);
+    size_t end = (thread_index == scan->thread_count - 1) ? scan->size :
+                 line_boundary(scan, scan->size / scan->thread_count *
+                                     (thread_index + 1));
+    uint64_t lines = 0;
+    uint64_t invalid = 0;
+
+    while (pos < end) {
+        packed_pattern_t pattern = 0;
+        int len = 0;
+        int bad = 0;
+
+        for (; pos < end && scan->data[pos] != '\n'; pos++) {
+            char c = scan->data[pos];
+
+            if (c >= '1' && c <= '0' + MAX_POINTS && len < MAX_POINTS) {
+                pattern |= (packed_pattern_t)(c - '0') << (4 * len++);
+            } else if (c != '\r' && c != ' ' && c != '\t') {
+                bad = 1;
+            }
+        }
+        pos++;
+
+        /* blank lines are not observations */
+        if (len == 0 && bad == 0) {
+            continue;
+        }
+
+        lines++;
+        if (bad || pattern_valid(&table->transitions, pattern) == 0) {
+            invalid++;
+            continue;
+        }
+        counts[pattern_rank(table, pattern)]++;
+        scan->length_lines[thread_index][len]++;
+    }
+
+    scan->lines[thread_index] = lines;
+    scan->invalid[thread_index] = invalid;
+    AUP_PROBE2(corpus_chunk_done, thread_index, lines);
+
+    return;
+}
+
+/*
+ * Sum the per thread counts of one rank range
+ */
+static void merge_worker(void *ctx, const int thread_index)
+{
+    struct corpus_scan *scan = ctx;
+    struct corpus_stats *stats = scan->stats;
+    uint32_t first = (uint32_t)((uint64_t)stats->pattern_count *
+                                thread_index / scan->thread_count);
+    uint32_t last = (uint32_t)((uint64_t)stats->pattern_count *
+                               (thread_index + 1) / scan->thread_count);
+    uint32_t rank;
+    int t;
+
+    for (rank = first; rank < last; rank++) {
+        uint64_t sum = 0;
+
+        for (t = 0; t < scan->thread_count; t++) {
+            sum += scan->counts[(size_t)t * stats->pattern_count + rank];
+        }
+        stats->frequency[rank] = sum;
+    }
+
+    return;
+}
+
+/*
+ * Count the valid patterns of a corpus file with one pattern per line
+ *
+ * \param path corpus file
+ * \param table rank table of the grid the patterns are drawn on
+ * \param thread_count number of threads to use
+ * \param stats statistics to fill, must be freed with free_corpus_stats()
+ * \return returns 0 on success, -1 if the file can not be read or out of
+ *         memory
+ */
+int analyze_corpus(const char *path, const struct rank_table *table,
+                   const int thread_count, struct corpus_stats *stats)
+{
+    struct corpus_scan *scan;
+    struct stat st;
+    void *data = NULL;
+    uint32_t rank;
+    int fd, t, len;
+
+    memset(stats, 0, sizeof(struct corpus_stats));
+    stats->table = table;
+    stats->pattern_count = table->suffix[0][0];
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    scan = calloc(1, sizeof(struct corpus_scan));
+    stats->frequency = calloc(stats->pattern_count, sizeof(uint64_t));
+    if (scan != NULL) {
+        scan->thread_count = thread_count < 1 ? 1 :
+                             thread_count > MAX_THREADS ? MAX_THREADS :
+                             thread_count;
+        scan->counts = calloc((size_t)scan->thread_count *
+                              stats->pattern_count, sizeof(uint32_t));
+    }
+    if (scan == NULL || scan->counts == NULL || stats->frequency == NULL) {
+        if (scan != NULL) {
+            free(scan->counts);
+        }
+        free(scan);
+        free_corpus_stats(stats);
+        if (data != NULL) {
+            munmap(data, (size_t)st.st_size);
+        }
+        return -1;
+    }
+
+    scan->data = data;
+    scan->size = (size_t)st.st_size;
+    scan->stats = stats;
+
+    run_parallel(scan->thread_count, count_worker, scan);
+    run_parallel(scan->thread_count, merge_worker, scan);
+
+    for (t = 0; t < scan->thread_count; t++) {
+        stats->lines += scan->lines[t];
+        stats->invalid += scan->invalid[t];
+        for (len = 1; len <= MAX_POINTS; len++) {
+            stats->length_lines[len] += scan->length_lines[t][len];
+        }
+    }
+    for (rank = 0; rank < stats->pattern_count; rank++) {
+        if (stats->frequency[rank] > 0) {
+            stats->distinct++;
+            stats->length_distinct[
+                packed_length(pattern_unrank(table, rank))]++;
+        }
+    }
+
+    free(scan->counts);
+    free(scan);
+    if (data != NULL) {
+        munmap(data, (size_t)st.st_size);
+    }
+    return 0;
+}
+
+/*
+ * Descending order of sort keys
+ */
+static int compare_keys_descending(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x < y) - (x > y);
+}
+
+/*
+ * Ranks of the observed patterns from the most to the least frequent, ties
+ * in rank order. This is the optimal guessing order against the corpus.
+ *
+ * \param stats statistics of the corpus
+ * \return array of stats->distinct ranks to be freed by the caller, NULL if
+ *         out of memory
+ */
+uint32_t *corpus_frequency_order(const struct corpus_stats *stats)
+{
+    uint64_t *keys;
+    uint32_t *order;
+    uint32_t rank, i = 0;
+
+    keys = malloc(((size_t)stats->distinct + 1) * sizeof(uint64_t));
+    order = malloc(((size_t)stats->distinct + 1) * sizeof(uint32_t));
+    if (keys == NULL || order == NULL) {
+        free(keys);
+        free(order);
+        return NULL;
+    }
+
+    /* ranks need 20 bits, inverted so that ties sort in rank order */
+    for (rank = 0; rank < stats->pattern_count; rank++) {
+        if (stats->frequency[rank] > 0) {
+            keys[i++] = (stats->frequency[rank] << 20) | (0xfffff - rank);
+        }
+    }
+    qsort(keys, stats->distinct, sizeof(uint64_t), compare_keys_descending);
+
+    for (i = 0; i < stats->distinct; i++) {
+        order[i] = 0xfffff - (uint32_t)(keys[i] & 0xfffff);
+    }
+
+    free(keys);
+    return order;
+}
+
+/*
+ * Free the counts of a corpus
+ *
+ * \param stats statistics to free
+ */
+void free_corpus_stats(struct corpus_stats *stats)
+{
+    free(stats->frequency);
+    stats->frequency = NULL;
+
+    return;
+}
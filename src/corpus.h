@@ -0,0 +1,40 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Frequency analysis of corpora of observed patterns.
+ */
+
+#ifndef AUPATTERNS_CORPUS_H
+#define AUPATTERNS_CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rank.h"
+
+/* Number of most frequent patterns listed */
+#define CORPUS_TOP_COUNT 10
+
+/* Frequency of every pattern of a corpus, indexed by rank */
+struct corpus_stats {
+    const struct rank_table *table;
+    uint32_t pattern_count;
+    uint64_t *frequency;
+    uint64_t lines;
+    uint64_t invalid;
+    uint64_t length_lines[MAX_POINTS + 1];
+    uint32_t length_distinct[MAX_POINTS + 1];
+    uint32_t distinct;
+};
+
+int analyze_corpus(const char *path, const struct rank_table *table,
+                   const int thread_count, struct corpus_stats *stats);
+uint32_t *corpus_frequency_order(const struct corpus_stats *stats);
+void free_corpus_stats(struct corpus_stats *stats);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Dense pattern ids relative to a constraint set.
+ *
+ * Global ranks waste bits on candidate lists of a guess: the patterns of a
+ * node set with some edges disabled and a length range are scattered over
+ * the whole rank space. Here ranks are taken in the same depth first order,
+ * but only the patterns of the constraint set are counted, so the set maps
+ * onto [0, N) and a list is a bitmap or offsets into that range. The
+ * allowed dots and edges are the transition matrix (as for -g and -e), and
+ * the length range is folded into the per state counts, which are a single
+ * backward pass over the states.
+ */
+
+#include "dense.h"
+
+/*
+ * Check whether a pattern length is in the range of the constraints
+ */
+static int length_allowed(const struct constraint_ranks *ranks,
+                          const int length)
+{
+    return length >= ranks->min_length && length <= ranks->max_length;
+}
+
+/*
+ * Fill the transitions and the per state counts of a constraint set
+ *
+ * \param block_matrix transition matrix of the allowed dots and edges
+ * \param min_length shortest pattern of the set (0 for no limit)
+ * \param max_length longest pattern of the set (0 for no limit)
+ * \param ranks table to fill
+ */
+void build_constraint_ranks(int block_matrix[][10], const int min_length,
+                            const int max_length,
+                            struct constraint_ranks *ranks)
+{
+    int mask, last, next;
+
+    build_transition_table(block_matrix, &ranks->transitions);
+    ranks->min_length = min_length > 0 ? min_length : 1;
+    ranks->max_length = max_length > 0 ? max_length : MAX_POINTS;
+
+    /* every successor state has a bigger mask, so go downwards */
+    for (mask = MASK_COUNT - 1; mask >= 0; mask--) {
+        int length = popcount_mask((unsigned int)mask);
+
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t candidates = ranks->transitions.next[mask][last];
+            uint32_t count;
+
+            if ((mask != 0 && (last == 0 || (mask & DOT_BIT(last)) == 0)) ||
+                length > ranks->max_length)
+            {
+                ranks->suffix[mask][last] = 0;
+                continue;
+            }
+
+            count = (mask != 0 && length_allowed(ranks, length)) ? 1 : 0;
+            if (length < ranks->max_length) {
+                for (next = 1; next <= MAX_POINTS; next++) {
+                    if (candidates & DOT_BIT(next)) {
+                        count += ranks->suffix[mask | DOT_BIT(next)][next];
+                    }
+                }
+            }
+            ranks->suffix[mask][last] = count;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Number of patterns of a constraint set
+ */
+uint32_t constraint_pattern_count(const struct constraint_ranks *ranks)
+{
+    return ranks->suffix[0][0];
+}
+
+/*
+ * Dense id of a pattern in a constraint set
+ *
+ * \param ranks table of the constraint set
+ * \param pattern packed pattern
+ * \param rank the id of the pattern, in [0, constraint_pattern_count())
+ * \return returns 0 on success, -1 if the pattern is not in the set
+ */
+int constraint_rank(const struct constraint_ranks *ranks,
+                    const packed_pattern_t pattern, uint32_t *rank)
+{
+    uint32_t r = 0;
+    unsigned int mask = 0;
+    int last = 0;
+    int depth = 0;
+    packed_pattern_t p;
+
+    if (pattern == 0) {
+        return -1;
+    }
+
+    for (p = pattern; p != 0; p >>= 4) {
+        int next = (int)(p & 0xf);
+        uint16_t before;
+
+        if (next == 0 || next > MAX_POINTS ||
+            (ranks->transitions.next[mask][last] & DOT_BIT(next)) == 0)
+        {
+            return -1;
+        }
+
+        /* skip the subtrees of the smaller siblings */
+        for (before = ranks->transitions.next[mask][last] &
+                      (DOT_BIT(next) - 1);
+             before != 0; before &= before - 1)
+        {
+            int sibling = __builtin_ctz(before) + 1;
+
+            r += ranks->suffix[mask | DOT_BIT(sibling)][sibling];
+        }
+
+        mask |= DOT_BIT(next);
+        last = next;
+        depth++;
+
+        /* skip the node itself if it is in the set and the pattern
+         * continues below it */
+        if ((p >> 4) != 0 && length_allowed(ranks, depth)) {
+            r++;
+        }
+    }
+
+    if (length_allowed(ranks, depth) == 0) {
+        return -1;
+    }
+
+    *rank = r;
+    return 0;
+}
+
+/*
+ * Pattern of a given dense id in a constraint set
+ *
+ * \param ranks table of the constraint set
+ * \param rank id of the pattern
+ * \return packed pattern, 0 if the id is out of range
+ */
+packed_pattern_t constraint_unrank(const struct constraint_ranks *ranks,
+                                   uint32_t rank)
+{
+    packed_pattern_t pattern = 0;
+    unsigned int mask = 0;
+    int last = 0;
+    int depth = 0;
+
+    if (rank >= ranks->suffix[0][0]) {
+        return 0;
+    }
+
+    for (;;) {
+        uint16_t candidates = ranks->transitions.next[mask][last];
+        int next = 0;
+
+        while (candidates != 0) {
+            uint32_t count;
+
+            next = __builtin_ctz(candidates) + 1;
+            count = ranks->suffix[mask | DOT_BIT(next)][next];
+            if (rank < count) {
+                break;
+            }
+            rank -= count;
+            candidates &= candidates - 1;
+        }
+
+        if (candidates == 0) {
+            return 0;
+        }
+
+        pattern |= (packed_pattern_t)next << (4 * depth);
+        depth++;
+        mask |= DOT_BIT(next);
+        last = next;
+
+        if (length_allowed(ranks, depth)) {
+            if (rank == 0) {
+                break;
+            }
+            rank--;
+        }
+    }
+
+    return pattern;
+}
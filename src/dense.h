@@ -0,0 +1,37 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Dense pattern ids relative to a constraint set.
+ */
+
+#ifndef AUPATTERNS_DENSE_H
+#define AUPATTERNS_DENSE_H
+
+#include "pattern.h"
+
+/*
+ * Transitions of the allowed dots and edges, and the number of patterns in
+ * the length range at or below every (used dot set, last dot) state
+ */
+struct constraint_ranks {
+    struct transition_table transitions;
+    int min_length;
+    int max_length;
+    uint32_t suffix[MASK_COUNT][MAX_POINTS + 1];
+};
+
+void build_constraint_ranks(int block_matrix[][10], const int min_length,
+                            const int max_length,
+                            struct constraint_ranks *ranks);
+uint32_t constraint_pattern_count(const struct constraint_ranks *ranks);
+int constraint_rank(const struct constraint_ranks *ranks,
+                    const packed_pattern_t pattern, uint32_t *rank);
+packed_pattern_t constraint_unrank(const struct constraint_ranks *ranks,
+                                   uint32_t rank);
+
+#endif
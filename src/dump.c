@@ -0,0 +1,395 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Binary pattern dumps and queries over them.
+ *
+ * A dump is a magic followed by the packed patterns, 8 bytes each, so it is
+ * a single column which can be queried without regenerating the space. A
+ * query maps the dump and evaluates the filter on blocks of records on every
+ * thread. The filter is compiled into word operations on the packed 4-bit
+ * digits: the length bounds are shifts, and whether a dot is used is the
+ * "has a zero nibble" test of the record xor-ed with the dot repeated in
+ * every nibble. Records which are not patterns (a zero or out of range
+ * nibble, a repeated dot) are skipped and counted first, since the word
+ * tests and the turn and path length ranges rely on valid dots.
+ * Matches are formatted into per thread buffers which are written in dump
+ * order after every round of blocks.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dump.h"
+#include "parallel.h"
+#include "probes.h"
+
+/* A 1 and the high bit in each of the nibbles of a pattern */
+#define NIBBLE_ONES 0x111111111ULL
+#define NIBBLE_HIGHS 0x888888888ULL
+
+/* Size of the formatted matches of a block */
+#define DUMP_BUFFER_SIZE ((size_t)DUMP_QUERY_BLOCK * (MAX_POINTS + 1))
+
+/* A pattern filter compiled to word operations */
+struct dump_predicate {
+    int min_shift;
+    int max_shift;
+    int start;
+    int end;
+    int use_count;
+    int avoid_count;
+    packed_pattern_t use[MAX_POINTS];
+    packed_pattern_t avoid[MAX_POINTS];
+    const struct pattern_filter *features;
+};
+
+/* Number of values of a nibble, the start and end counts of broken records
+ * are kept out of range */
+#define NIBBLE_VALUES 16
+
+/* Shared state of the scanning workers */
+struct dump_scan {
+    const packed_pattern_t *records;
+    uint64_t record_count;
+    uint64_t round_first;
+    int thread_count;
+    struct dump_predicate predicate;
+    char *buffers;
+    size_t fill[MAX_THREADS];
+    uint64_t invalid[MAX_THREADS];
+    uint64_t length_matches[MAX_THREADS][MAX_POINTS + 1];
+    uint64_t start_matches[MAX_THREADS][NIBBLE_VALUES];
+    uint64_t end_matches[MAX_THREADS][NIBBLE_VALUES];
+};
+
+static void dump_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct dump_writer *writer = ctx;
+    packed_pattern_t records[PATTERN_BATCH_SIZE];
+    size_t i, n = 0;
+
+    for (i = 0; i < batch->count; i++) {
+        if (pattern_filter_match(writer->filter, batch->patterns[i])) {
+            records[n++] = batch->patterns[i];
+        }
+    }
+
+    if (n > 0 && fwrite(records, sizeof(packed_pattern_t), n,
+                        writer->output_file) != n)
+    {
+        writer->errors++;
+    }
+    writer->count += n;
+
+    return;
+}
+
+/*
+ * Create a dump and write its magic. The file does not have to be seekable,
+ * so dumps can be piped.
+ *
+ * \param path file to create
+ * \return the open dump, NULL if it could not be created
+ */
+FILE *create_dump(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file != NULL &&
+        fwrite(DUMP_MAGIC, 1, DUMP_MAGIC_SIZE, file) != DUMP_MAGIC_SIZE)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+/*
+ * Register a visitor appending the packed patterns to a dump created by
+ * create_dump(), so several passes can go into one dump.
+ *
+ * \param pipeline pipeline to add to
+ * \param writer dump file and filter of the patterns to write
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_dump_writer(struct visitor_pipeline *pipeline,
+                    struct dump_writer *writer)
+{
+    struct pattern_visitor visitor;
+
+    writer->count = 0;
+    writer->errors = 0;
+
+    visitor.visit_batch = dump_batch;
+    visitor.finish = NULL;
+    visitor.ctx = writer;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
+
+/*
+ * Compile a filter
+ */
+static void compile_predicate(const struct pattern_filter *filter,
+                              struct dump_predicate *predicate)
+{
+    int dot;
+
+    predicate->min_shift = filter->min_length > 1 ?
+                           4 * (filter->min_length - 1) : 0;
+    predicate->max_shift = 4 * (filter->max_length > 0 ?
+                                filter->max_length : MAX_POINTS);
+    predicate->start = filter->start;
+    predicate->end = filter->end;
+    predicate->use_count = 0;
+    predicate->avoid_count = 0;
+
+    for (dot = 1; dot <= MAX_POINTS; dot++) {
+        if (filter->must_use & DOT_BIT(dot)) {
+            predicate->use[predicate->use_count++] = dot * NIBBLE_ONES;
+        }
+        if (filter->must_avoid & DOT_BIT(dot)) {
+            predicate->avoid[predicate->avoid_count++] = dot * NIBBLE_ONES;
+        }
+    }
+
+    /* the turn and path ranges are left to the generic filter */
+    predicate->features = (filter->min_turns >= 0 || filter->min_path >= 0) ?
+                          filter : NULL;
+
+    return;
+}
+
+/*
+ * Check whether a dot, given repeated in every nibble, is in a pattern
+ */
+static int has_dot(const packed_pattern_t pattern,
+                   const packed_pattern_t repeated)
+{
+    packed_pattern_t t = pattern ^ repeated;
+
+    return ((t - NIBBLE_ONES) & ~t & NIBBLE_HIGHS) != 0;
+}
+
+/*
+ * Check that a record is a pattern: dots 1-9 from the lowest nibble up,
+ * none of them repeated and no gap before the last one
+ */
+static int valid_record(packed_pattern_t pattern)
+{
+    unsigned int used = 0;
+    int dot;
+
+    while (pattern != 0) {
+        dot = (int)(pattern & 0xf);
+        if (dot == 0 || dot > MAX_POINTS || (used & DOT_BIT(dot)) != 0) {
+            return 0;
+        }
+        used |= DOT_BIT(dot);
+        pattern >>= 4;
+    }
+
+    return used != 0;
+}
+
+static int predicate_match(const struct dump_predicate *predicate,
+                           const packed_pattern_t pattern)
+{
+    int i;
+
+    if ((pattern >> predicate->min_shift) == 0 ||
+        (pattern >> predicate->max_shift) != 0)
+    {
+        return 0;
+    }
+    if (predicate->start > 0 && (int)(pattern & 0xf) != predicate->start) {
+        return 0;
+    }
+    if (predicate->end > 0 &&
+        (int)(pattern >> ((63 - __builtin_clzll(pattern)) & ~3)) !=
+            predicate->end)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < predicate->use_count; i++) {
+        if (has_dot(pattern, predicate->use[i]) == 0) {
+            return 0;
+        }
+    }
+    for (i = 0; i < predicate->avoid_count; i++) {
+        if (has_dot(pattern, predicate->avoid[i])) {
+            return 0;
+        }
+    }
+
+    if (predicate->features != NULL) {
+        return pattern_filter_match(predicate->features, pattern);
+    }
+
+    return 1;
+}
+
+/*
+ * Scan the block of one thread in the current round
+ */
+static void scan_worker(void *ctx, const int thread_index)
+{
+    struct dump_scan *scan = ctx;
+    const struct dump_predicate *predicate = &scan->predicate;
+    uint64_t first = (scan->round_first + thread_index) * DUMP_QUERY_BLOCK;
+    uint64_t last = first + DUMP_QUERY_BLOCK;
+    char *buffer = scan->buffers == NULL ? NULL :
+                   scan->buffers + thread_index * DUMP_BUFFER_SIZE;
+    size_t fill = 0;
+    uint64_t invalid = 0;
+    uint64_t i;
+
+    if (last > scan->record_count) {
+        last = scan->record_count;
+    }
+
+    for (i = first; i < last; i++) {
+        packed_pattern_t pattern = scan->records[i];
+        int top;
+
+        if (valid_record(pattern) == 0) {
+            invalid++;
+            continue;
+        }
+        if (predicate_match(predicate, pattern) == 0) {
+            continue;
+        }
+
+        top = (63 - __builtin_clzll(pattern)) / 4;
+        scan->length_matches[thread_index][top + 1]++;
+        scan->start_matches[thread_index][pattern & 0xf]++;
+        scan->end_matches[thread_index][(pattern >> (4 * top)) & 0xf]++;
+
+        if (buffer != NULL) {
+            fill += (size_t)packed_to_string(pattern, buffer + fill);
+            buffer[fill++] = '\n';
+        }
+    }
+    scan->fill[thread_index] = fill;
+    scan->invalid[thread_index] += invalid;
+
+    return;
+}
+
+/*
+ * Run a query over a dump
+ *
+ * \param path dump file
+ * \param query filter, output and threads of the query, gets the totals
+ * \return returns 0 on success, -1 if the file is not a readable dump, the
+ *         matches could not be written or out of memory
+ */
+int scan_dump(const char *path, struct dump_query *query)
+{
+    struct dump_scan *scan;
+    struct stat st;
+    void *data;
+    uint64_t blocks;
+    int fd, t, i;
+
+    query->records = 0;
+    query->invalid = 0;
+    query->matches = 0;
+    memset(query->length_matches, 0, sizeof(query->length_matches));
+    memset(query->start_matches, 0, sizeof(query->start_matches));
+    memset(query->end_matches, 0, sizeof(query->end_matches));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < DUMP_MAGIC_SIZE ||
+        (st.st_size - DUMP_MAGIC_SIZE) % sizeof(packed_pattern_t) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    if (memcmp(data, DUMP_MAGIC, DUMP_MAGIC_SIZE) != 0) {
+        munmap(data, (size_t)st.st_size);
+        return -1;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    scan = calloc(1, sizeof(struct dump_scan));
+    if (scan == NULL) {
+        munmap(data, (size_t)st.st_size);
+        return -1;
+    }
+    scan->records = (const packed_pattern_t *)
+                    ((const char *)data + DUMP_MAGIC_SIZE);
+    scan->record_count = (uint64_t)(st.st_size - DUMP_MAGIC_SIZE) /
+                         sizeof(packed_pattern_t);
+    compile_predicate(query->filter, &scan->predicate);
+
+    /* no more threads than blocks */
+    blocks = (scan->record_count + DUMP_QUERY_BLOCK - 1) / DUMP_QUERY_BLOCK;
+    scan->thread_count = query->thread_count < 1 ? 1 :
+                         query->thread_count > MAX_THREADS ? MAX_THREADS :
+                         query->thread_count;
+    if ((uint64_t)scan->thread_count > blocks) {
+        scan->thread_count = blocks > 0 ? (int)blocks : 1;
+    }
+
+    if (query->output_file != NULL) {
+        scan->buffers = malloc(scan->thread_count * DUMP_BUFFER_SIZE);
+        if (scan->buffers == NULL) {
+            free(scan);
+            munmap(data, (size_t)st.st_size);
+            return -1;
+        }
+    }
+
+    for (scan->round_first = 0; scan->round_first < blocks;
+         scan->round_first += scan->thread_count)
+    {
+        run_parallel(scan->thread_count, scan_worker, scan);
+        for (t = 0; scan->buffers != NULL && t < scan->thread_count; t++) {
+            if (fwrite(scan->buffers + t * DUMP_BUFFER_SIZE, 1,
+                       scan->fill[t], query->output_file) != scan->fill[t])
+            {
+                free(scan->buffers);
+                free(scan);
+                munmap(data, (size_t)st.st_size);
+                return -1;
+            }
+        }
+        AUP_PROBE2(dump_round, scan->round_first, blocks);
+    }
+
+    query->records = scan->record_count;
+    for (t = 0; t < scan->thread_count; t++) {
+        query->invalid += scan->invalid[t];
+        for (i = 1; i <= MAX_POINTS; i++) {
+            query->length_matches[i] += scan->length_matches[t][i];
+            query->start_matches[i] += scan->start_matches[t][i];
+            query->end_matches[i] += scan->end_matches[t][i];
+            query->matches += scan->length_matches[t][i];
+        }
+    }
+
+    free(scan->buffers);
+    free(scan);
+    munmap(data, (size_t)st.st_size);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Binary pattern dumps and queries over them.
+ */
+
+#ifndef AUPATTERNS_DUMP_H
+#define AUPATTERNS_DUMP_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "visitor.h"
+
+/* First bytes of a dump, followed by native endian packed patterns */
+#define DUMP_MAGIC "AUPDUMP1"
+#define DUMP_MAGIC_SIZE 8
+
+/* Number of records a thread scans at once */
+#define DUMP_QUERY_BLOCK (1 << 16)
+
+/* Writes the packed patterns matching a filter into a dump */
+struct dump_writer {
+    FILE *output_file;
+    const struct pattern_filter *filter;
+    unsigned long count;
+    int errors;
+};
+
+/* A filter evaluated over a dump, with the matches written in dump order to
+ * output_file if it is not NULL. Records that are not patterns are skipped
+ * and only counted. */
+struct dump_query {
+    const struct pattern_filter *filter;
+    FILE *output_file;
+    int thread_count;
+    uint64_t records;
+    uint64_t invalid;
+    uint64_t matches;
+    uint64_t length_matches[MAX_POINTS + 1];
+    uint64_t start_matches[MAX_POINTS + 1];
+    uint64_t end_matches[MAX_POINTS + 1];
+};
+
+FILE *create_dump(const char *path);
+int add_dump_writer(struct visitor_pipeline *pipeline,
+                    struct dump_writer *writer);
+int scan_dump(const char *path, struct dump_query *query);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Build time generator of the tables declared in tables.h. The 3x3 space is
+ * small enough to be walked completely, so summaries, guesses, validation and
+ * ranking on the standard grid need no setup at run time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rank.h"
+#include "score.h"
+
+/* State of the generator while walking the pattern space */
+struct generator {
+    FILE *out;
+    uint32_t subset_count[MASK_COUNT];
+    uint32_t length_count[MAX_POINTS + 1];
+    uint32_t pattern_count;
+};
+
+/*
+ * Count a pattern and write its score
+ */
+static void generate_pattern(void *ctx, const packed_pattern_t pattern,
+                             const unsigned int used_mask)
+{
+    struct generator *gen = ctx;
+
+    gen->subset_count[used_mask]++;
+    gen->length_count[packed_length(pattern)]++;
+    fprintf(gen->out, "%s%d", (gen->pattern_count == 0) ? "\n    " :
+            (gen->pattern_count % 20 == 0) ? ",\n    " : ", ",
+            pattern_score(pattern));
+    gen->pattern_count++;
+
+    return;
+}
+
+/*
+ * Write an array of 32 bit counts
+ */
+static void write_counts(FILE *out, const uint32_t counts[], const int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        fprintf(out, "%s%lu", (i % 8 == 0) ? (i == 0 ? "\n    " : ",\n    ") :
+                ", ", (unsigned long)counts[i]);
+    }
+
+    return;
+}
+
+/*
+ * Generator entry, writes the tables to the file given as argument
+ */
+int main(int argc, char *argv[])
+{
+    struct rank_table *table;
+    struct generator gen = { NULL, { 0 }, { 0 }, 0 };
+    int mask;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s OUTPUT\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    table = malloc(sizeof(struct rank_table));
+    gen.out = fopen(argv[1], "w");
+    if (table == NULL || gen.out == NULL) {
+        fprintf(stderr, "Could not open \"%s\" output file for writing\n",
+                argv[1]);
+        free(table);
+        return EXIT_FAILURE;
+    }
+
+    build_rank_table(pattern_block_matrix, table);
+
+    fprintf(gen.out, "/* Generated by gentables, do not edit. */\n\n");
+    fprintf(gen.out, "#include \"tables.h\"\n\n");
+
+    /* scores come in rank order, which is the order of enumerate_from() */
+    fprintf(gen.out, "const uint8_t embedded_scores[] = {");
+    enumerate_from(&table->transitions, 0, 0, generate_pattern, &gen);
+    fprintf(gen.out, "\n};\n\n");
+
+    fprintf(gen.out, "const uint32_t embedded_pattern_count = %lu;\n\n",
+            (unsigned long)gen.pattern_count);
+
+    fprintf(gen.out, "const uint32_t embedded_subset_count[MASK_COUNT] = {");
+    write_counts(gen.out, gen.subset_count, MASK_COUNT);
+    fprintf(gen.out, "\n};\n\n");
+
+    fprintf(gen.out,
+            "const uint32_t embedded_length_count[MAX_POINTS + 1] = {");
+    write_counts(gen.out, gen.length_count, MAX_POINTS + 1);
+    fprintf(gen.out, "\n};\n\n");
+
+    fprintf(gen.out, "const struct rank_table embedded_rank_table = {\n");
+    fprintf(gen.out, "    {{");
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        int last;
+
+        fprintf(gen.out, "%s{", (mask == 0) ? "\n        " : ",\n        ");
+        for (last = 0; last <= MAX_POINTS; last++) {
+            fprintf(gen.out, "%s%u", (last == 0) ? "" : ", ",
+                    (unsigned int)table->transitions.next[mask][last]);
+        }
+        fprintf(gen.out, "}");
+    }
+    fprintf(gen.out, "\n    }},\n    {");
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        int last;
+
+        fprintf(gen.out, "%s{", (mask == 0) ? "\n        " : ",\n        ");
+        for (last = 0; last <= MAX_POINTS; last++) {
+            fprintf(gen.out, "%s%lu", (last == 0) ? "" : ", ",
+                    (unsigned long)table->suffix[mask][last]);
+        }
+        fprintf(gen.out, "}");
+    }
+    fprintf(gen.out, "\n    }\n};\n");
+
+    free(table);
+    if (fclose(gen.out) != 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Fast generator of the complete and near complete patterns.
+ *
+ * Patterns of length 8 and 9 are about three quarters of the space, and the
+ * general enumerators spend most of their time on them. Here the possible
+ * extension lengths of the order table (a backward reachability DP over the
+ * used dot sets) are turned into the set of children of every state which
+ * can still reach the target length. The depth first walk then only visits
+ * prefixes of target length patterns, emits the last dot of a pattern
+ * without descending and writes the packed patterns straight into a buffer.
+ * The patterns come out in lexicographic order.
+ */
+
+#include "hamilton.h"
+
+/*
+ * Prune the transitions to the ones which can reach a given length
+ *
+ * \param order order table of the transition matrix
+ * \param length target pattern length (1..MAX_POINTS)
+ * \param table table to fill
+ */
+void build_hamilton_table(const struct order_table *order, const int length,
+                          struct hamilton_table *table)
+{
+    unsigned int mask;
+    int last;
+
+    table->length = length;
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        int remaining = length - popcount_mask(mask) - 1;
+
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t candidates = order->transitions.next[mask][last];
+            uint16_t viable = 0;
+
+            for (; remaining >= 0 && candidates != 0;
+                 candidates &= candidates - 1)
+            {
+                int next = __builtin_ctz(candidates) + 1;
+
+                if (order->extend[mask | DOT_BIT(next)][next] &
+                    (1u << remaining))
+                {
+                    viable |= DOT_BIT(next);
+                }
+            }
+            table->viable[mask][last] = viable;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Generate every pattern of the target length in lexicographic order
+ *
+ * \param table pruned transitions of the target length
+ * \param buffer buffer of HAMILTON_BUFFER_SIZE patterns
+ * \param flush called with every full buffer and the rest at the end
+ * \param ctx context passed to the callback
+ * \return number of patterns generated
+ */
+size_t enumerate_hamilton(const struct hamilton_table *table,
+                          packed_pattern_t *buffer, packed_flush_fn flush,
+                          void *ctx)
+{
+    uint16_t candidates[MAX_POINTS];
+    packed_pattern_t pattern = 0;
+    unsigned int mask = 0;
+    int leaf = table->length - 1;
+    int depth = 0;
+    size_t fill = 0;
+    size_t total = 0;
+
+    candidates[0] = table->viable[0][0];
+
+    for (;;) {
+        int next;
+
+        if (candidates[depth] == 0) {
+            if (depth == 0) {
+                break;
+            }
+            depth--;
+            mask &= ~DOT_BIT(PACKED_DOT(pattern, depth));
+            pattern &= ~((packed_pattern_t)0xf << (4 * depth));
+            continue;
+        }
+
+        next = __builtin_ctz(candidates[depth]) + 1;
+        candidates[depth] &= candidates[depth] - 1;
+
+        /* the last dot completes a pattern, no need to descend */
+        if (depth == leaf) {
+            buffer[fill++] = pattern | (packed_pattern_t)next << (4 * depth);
+            if (fill == HAMILTON_BUFFER_SIZE) {
+                flush(ctx, buffer, fill);
+                total += fill;
+                fill = 0;
+            }
+            continue;
+        }
+
+        pattern |= (packed_pattern_t)next << (4 * depth);
+        mask |= DOT_BIT(next);
+        depth++;
+        candidates[depth] = table->viable[mask][next];
+    }
+
+    if (fill > 0) {
+        flush(ctx, buffer, fill);
+        total += fill;
+    }
+
+    return total;
+}
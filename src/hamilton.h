@@ -0,0 +1,44 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Fast generator of the complete and near complete patterns.
+ */
+
+#ifndef AUPATTERNS_HAMILTON_H
+#define AUPATTERNS_HAMILTON_H
+
+#include <stddef.h>
+
+#include "order.h"
+
+/* Shortest length the generator is used for */
+#define HAMILTON_MIN_LENGTH (MAX_POINTS - 1)
+
+/* Number of patterns emitted at once */
+#define HAMILTON_BUFFER_SIZE 4096
+
+/*
+ * Children of every state which still lead to a pattern of the target
+ * length, so the generator never walks into a dead end
+ */
+struct hamilton_table {
+    int length;
+    uint16_t viable[MASK_COUNT][MAX_POINTS + 1];
+};
+
+/* Callback for every full buffer of generated patterns */
+typedef void (*packed_flush_fn)(void *ctx, const packed_pattern_t *patterns,
+                                const size_t count);
+
+void build_hamilton_table(const struct order_table *order, const int length,
+                          struct hamilton_table *table);
+size_t enumerate_hamilton(const struct hamilton_table *table,
+                          packed_pattern_t *buffer, packed_flush_fn flush,
+                          void *ctx);
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Hash functions of the pattern digests.
+ *
+ * A pattern is hashed the way Android stores it in gesture.key: one byte per
+ * dot holding the zero based dot index. The hashes are fed byte by byte and
+ * can be finalized without ending the state, so the visitor pipeline keeps
+ * the hash state of every prefix and a pattern costs one byte of update over
+ * its parent plus the finalization. A salt is hashed as a fixed prefix, it is
+ * absorbed into the root state once instead of once per pattern.
+ */
+
+#include <string.h>
+
+#include "hash.h"
+
+/* State of the SHA-1 hash */
+struct sha1_state {
+    uint32_t h[5];
+    uint64_t length;
+    unsigned char buffer[64];
+    size_t used;
+};
+
+/* Rotate a 32 bit word left */
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/*
+ * Process one 64 byte block
+ */
+static void sha1_compress(uint32_t h[5], const unsigned char *block)
+{
+    uint32_t w[80];
+    uint32_t a, b, c, d, e, f, k, t;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[4 * i] << 24) |
+               ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) |
+               (uint32_t)block[4 * i + 3];
+    }
+    for (i = 16; i < 80; i++) {
+        w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    a = h[0];
+    b = h[1];
+    c = h[2];
+    d = h[3];
+    e = h[4];
+
+    for (i = 0; i < 80; i++) {
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        t = ROL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+
+    return;
+}
+
+static void sha1_init(void *state)
+{
+    struct sha1_state *s = state;
+
+    s->h[0] = 0x67452301;
+    s->h[1] = 0xefcdab89;
+    s->h[2] = 0x98badcfe;
+    s->h[3] = 0x10325476;
+    s->h[4] = 0xc3d2e1f0;
+    s->length = 0;
+    s->used = 0;
+
+    return;
+}
+
+static void sha1_update(void *state, const unsigned char *data,
+                        const size_t len)
+{
+    struct sha1_state *s = state;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        s->buffer[s->used++] = data[i];
+        if (s->used == 64) {
+            sha1_compress(s->h, s->buffer);
+            s->used = 0;
+        }
+    }
+    s->length += len;
+
+    return;
+}
+
+static void sha1_final(const void *state, unsigned char *digest)
+{
+    struct sha1_state s;
+    uint64_t bits;
+    int i;
+
+    memcpy(&s, state, sizeof(s));
+    bits = s.length * 8;
+
+    s.buffer[s.used++] = 0x80;
+    if (s.used > 56) {
+        memset(s.buffer + s.used, 0, 64 - s.used);
+        sha1_compress(s.h, s.buffer);
+        s.used = 0;
+    }
+    memset(s.buffer + s.used, 0, 56 - s.used);
+    for (i = 0; i < 8; i++) {
+        s.buffer[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha1_compress(s.h, s.buffer);
+
+    for (i = 0; i < 20; i++) {
+        digest[i] = (unsigned char)(s.h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+
+    return;
+}
+
+static void fnv1a_init(void *state)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    memcpy(state, &h, sizeof(h));
+
+    return;
+}
+
+static void fnv1a_update(void *state, const unsigned char *data,
+                         const size_t len)
+{
+    uint64_t h;
+    size_t i;
+
+    memcpy(&h, state, sizeof(h));
+    for (i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    memcpy(state, &h, sizeof(h));
+
+    return;
+}
+
+static void fnv1a_final(const void *state, unsigned char *digest)
+{
+    uint64_t h;
+    int i;
+
+    memcpy(&h, state, sizeof(h));
+    for (i = 0; i < 8; i++) {
+        digest[i] = (unsigned char)(h >> (56 - 8 * i));
+    }
+
+    return;
+}
+
+/* Available hash functions */
+static const struct pattern_hash pattern_hashes[] = {
+    { "sha1", sizeof(struct sha1_state), 20,
+      sha1_init, sha1_update, sha1_final },
+    { "fnv1a", sizeof(uint64_t), 8,
+      fnv1a_init, fnv1a_update, fnv1a_final },
+};
+
+/*
+ * Look up a hash function by name
+ *
+ * \param name name of the hash (sha1 or fnv1a)
+ * \return hash function, NULL if unknown
+ */
+const struct pattern_hash *find_pattern_hash(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(pattern_hashes) / sizeof(pattern_hashes[0]); i++) {
+        if (strcmp(pattern_hashes[i].name, name) == 0) {
+            return &pattern_hashes[i];
+        }
+    }
+
+    return NULL;
+}
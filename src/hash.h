@@ -0,0 +1,38 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern hashing with per-depth hash states during enumeration.
+ */
+
+#ifndef AUPATTERNS_HASH_H
+#define AUPATTERNS_HASH_H
+
+#include <stddef.h>
+
+#include "pattern.h"
+
+/* Maximum size of a hash state and of a digest in bytes */
+#define MAX_HASH_STATE 128
+#define MAX_HASH_DIGEST 32
+
+/*
+ * A hash function fed byte by byte. final() must not change the state, so a
+ * state can be finalized and then extended further.
+ */
+struct pattern_hash {
+    const char *name;
+    size_t state_size;
+    int digest_size;
+    void (*init)(void *state);
+    void (*update)(void *state, const unsigned char *data, const size_t len);
+    void (*final)(const void *state, unsigned char *digest);
+};
+
+const struct pattern_hash *find_pattern_hash(const char *name);
+
+#endif
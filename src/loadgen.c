@@ -0,0 +1,638 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Load generator for the pattern queries.
+ *
+ * A mix of count, list, validation, sample and guess queries is run on a
+ * number of threads against a table domain, optionally while new table sets
+ * are published, for a series of target rates. At a target rate every
+ * thread has a fixed schedule of intended start times, and the latency of a
+ * query is measured from its intended start, so a stall delays (and is
+ * charged to) every query scheduled behind it instead of silently lowering
+ * the rate: the coordinated omission correction. The plain service times
+ * are kept alongside for comparison. The run stops at its deadline even
+ * above capacity, the scheduled queries that never started are reported
+ * as missed. A rate of 0 runs the queries back to
+ * back, giving the saturation throughput. One line is printed per rate,
+ * which together make the throughput vs latency curve.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dense.h"
+#include "parallel.h"
+#include "tableset.h"
+
+/* Default number of query threads, seconds per rate and rates */
+#define LOAD_THREADS 4
+#define LOAD_SECONDS 2.0
+#define LOAD_RATES "0"
+
+/* Interval of the table set reloads, in nanoseconds */
+#define RELOAD_INTERVAL 10000000ULL
+
+/* Latency histogram: 16 linear sub-buckets per power of two (6% error) */
+#define LATENCY_SUB_BITS 4
+#define LATENCY_BUCKETS (64 << LATENCY_SUB_BITS)
+
+/* Maximum number of rates of a run */
+#define MAX_RATES 32
+
+enum query_kind {
+    QUERY_COUNT,
+    QUERY_LIST,
+    QUERY_VALIDATE,
+    QUERY_SAMPLE,
+    QUERY_GUESS,
+    QUERY_KINDS
+};
+
+static const char *query_names[QUERY_KINDS] = {
+    "count", "list", "validate", "sample", "guess"
+};
+
+/* Latencies of one thread */
+struct latency_histogram {
+    uint64_t count;
+    uint64_t max;
+    uint64_t buckets[LATENCY_BUCKETS];
+};
+
+/* Per thread state, one cache line apart from the others at least */
+struct load_thread {
+    struct scratch_arena *arena;
+    uint64_t random;
+    uint64_t queries[QUERY_KINDS];
+    uint64_t checksum;
+    uint64_t missed;
+    struct latency_histogram corrected;
+    struct latency_histogram service;
+    struct constraint_ranks ranks;
+    char pad[CACHE_LINE];
+};
+
+/* Shared state of one rate */
+struct load_run {
+    struct table_domain domain;
+    int thread_count;
+    int reload;
+    unsigned long reloads;
+    int weights[QUERY_KINDS];
+    int weight_total;
+    double rate;
+    uint64_t start;
+    uint64_t end;
+    struct load_thread *threads;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(const uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+        ;
+    }
+
+    return;
+}
+
+/*
+ * xorshift64* generator, one per thread
+ */
+static uint64_t next_random(struct load_thread *thread)
+{
+    thread->random ^= thread->random >> 12;
+    thread->random ^= thread->random << 25;
+    thread->random ^= thread->random >> 27;
+
+    return thread->random * 0x2545f4914f6cdd1dULL;
+}
+
+static int latency_bucket(const uint64_t ns)
+{
+    int shift;
+
+    if (ns < (1u << LATENCY_SUB_BITS)) {
+        return (int)ns;
+    }
+    shift = 63 - __builtin_clzll(ns) - LATENCY_SUB_BITS;
+
+    return ((shift + 1) << LATENCY_SUB_BITS) +
+           (int)((ns >> shift) & ((1u << LATENCY_SUB_BITS) - 1));
+}
+
+/*
+ * Largest latency of a bucket
+ */
+static uint64_t bucket_latency(const int bucket)
+{
+    int shift = (bucket >> LATENCY_SUB_BITS) - 1;
+    uint64_t mantissa = (uint64_t)(bucket & ((1 << LATENCY_SUB_BITS) - 1)) |
+                        (1u << LATENCY_SUB_BITS);
+
+    if (shift < 0) {
+        return (uint64_t)bucket;
+    }
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+static void record_latency(struct latency_histogram *histogram,
+                           const uint64_t ns)
+{
+    histogram->buckets[latency_bucket(ns)]++;
+    histogram->count++;
+    if (ns > histogram->max) {
+        histogram->max = ns;
+    }
+
+    return;
+}
+
+/*
+ * Latency below which a fraction of the queries finished
+ */
+static uint64_t latency_percentile(const struct latency_histogram *histogram,
+                                   const double fraction)
+{
+    uint64_t target = (uint64_t)(fraction * histogram->count);
+    uint64_t seen = 0;
+    int i;
+
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen > target) {
+            return bucket_latency(i) < histogram->max ?
+                   bucket_latency(i) : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+static void merge_histogram(struct latency_histogram *into,
+                            const struct latency_histogram *from)
+{
+    int i;
+
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+    into->count += from->count;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+
+    return;
+}
+
+/*
+ * Random pattern of 4 to 9 dots, not necessarily valid
+ */
+static packed_pattern_t random_pattern(struct load_thread *thread)
+{
+    uint64_t r = next_random(thread);
+    int len = 4 + (int)(r % 6);
+    packed_pattern_t pattern = 0;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        r = next_random(thread);
+        pattern |= (packed_pattern_t)(1 + r % MAX_POINTS) << (4 * i);
+    }
+
+    return pattern;
+}
+
+/* Counting visitor of the list queries */
+static void count_visit(void *ctx, const packed_pattern_t pattern,
+                        const unsigned int used_mask)
+{
+    uint64_t *count = ctx;
+
+    (void)pattern;
+    (void)used_mask;
+    (*count)++;
+
+    return;
+}
+
+/*
+ * Run one query on a table set
+ *
+ * \return a value depending on the result, so no query is optimized out
+ */
+static uint64_t run_query(struct load_thread *thread,
+                          const struct table_set *set,
+                          const enum query_kind kind)
+{
+    int block_matrix[10][10];
+    int pattern_count[MAX_POINTS];
+    uint64_t result = 0;
+    uint32_t rank;
+    packed_pattern_t pattern;
+    unsigned int guess;
+    int i, j;
+
+    switch (kind) {
+    case QUERY_COUNT:
+        if (set->has_rule == 0) {
+            return set->ranks.suffix[0][0];
+        }
+        memcpy(block_matrix, set->block_matrix, sizeof(block_matrix));
+        if (count_with_rule(block_matrix, &set->rule, pattern_count,
+                            NULL, thread->arena) == 0)
+        {
+            for (i = 0; i < MAX_POINTS; i++) {
+                result += (uint64_t)pattern_count[i];
+            }
+        }
+        arena_reset(thread->arena);
+        break;
+    case QUERY_LIST:
+        /* every pattern starting with a random valid pair of dots */
+        pattern = pattern_unrank(&set->ranks, (uint32_t)(next_random(thread) %
+                                 set->ranks.suffix[0][0]));
+        pattern &= 0xff;
+        if (pattern_valid(&set->ranks.transitions, pattern)) {
+            enumerate_from(&set->ranks.transitions, pattern, 0, count_visit,
+                           &result);
+        }
+        break;
+    case QUERY_VALIDATE:
+        pattern = random_pattern(thread);
+        if (pattern_valid(&set->ranks.transitions, pattern)) {
+            result = pattern_rank(&set->ranks, pattern) + 1;
+        }
+        break;
+    case QUERY_SAMPLE:
+        result = pattern_unrank(&set->ranks, (uint32_t)(next_random(thread) %
+                                set->ranks.suffix[0][0]));
+        break;
+    case QUERY_GUESS:
+        /* a random node set of 5 to 8 dots, patterns of length 4 and up */
+        do {
+            guess = (unsigned int)next_random(thread) & (MASK_COUNT - 1);
+        } while (popcount_mask(guess) < 5 || popcount_mask(guess) > 8);
+        memcpy(block_matrix, set->block_matrix, sizeof(block_matrix));
+        for (i = 0; i <= MAX_POINTS; i++) {
+            for (j = 1; j <= MAX_POINTS; j++) {
+                if ((guess & DOT_BIT(j)) == 0 ||
+                    (i > 0 && (guess & DOT_BIT(i)) == 0))
+                {
+                    block_matrix[i][j] = -1;
+                }
+            }
+        }
+        build_constraint_ranks(block_matrix, 4, 0, &thread->ranks);
+        result = constraint_pattern_count(&thread->ranks);
+        if (result > 0 && constraint_rank(&thread->ranks,
+                constraint_unrank(&thread->ranks, (uint32_t)(result / 2)),
+                &rank) == 0)
+        {
+            result += rank;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return result;
+}
+
+static enum query_kind pick_query(struct load_run *run,
+                                  struct load_thread *thread)
+{
+    int r = (int)(next_random(thread) % (uint64_t)run->weight_total);
+    int kind;
+
+    for (kind = 0; kind < QUERY_KINDS - 1; kind++) {
+        if (r < run->weights[kind]) {
+            break;
+        }
+        r -= run->weights[kind];
+    }
+
+    return (enum query_kind)kind;
+}
+
+/*
+ * Publish a new table set every reload interval until the end of the run
+ */
+static void reload_tables(struct load_run *run)
+{
+    static const char *rules[] = { NULL, "no-uturn", NULL };
+    static const char *policies[] = { NULL, NULL, "14789,123" };
+    uint64_t next = run->start;
+    int i = 0;
+
+    while ((next += RELOAD_INTERVAL) < run->end) {
+        struct table_set *set;
+
+        sleep_until(next);
+        i = (i + 1) % 3;
+        set = build_table_set(pattern_block_matrix, rules[i], policies[i]);
+        if (set != NULL) {
+            table_set_publish(&run->domain, set);
+            run->reloads++;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Query thread, or the reloading one after the query threads
+ */
+static void load_worker(void *ctx, const int thread_index)
+{
+    struct load_run *run = ctx;
+    struct load_thread *thread;
+    uint64_t interval = 0;
+    uint64_t intended;
+
+    if (thread_index == run->thread_count) {
+        reload_tables(run);
+        return;
+    }
+
+    thread = &run->threads[thread_index];
+    if (run->rate > 0) {
+        interval = (uint64_t)(1e9 * run->thread_count / run->rate);
+    }
+
+    /* threads are staggered over the first interval */
+    intended = run->start + interval * thread_index / run->thread_count;
+    while (intended < run->end) {
+        const struct table_set *set;
+        enum query_kind kind = pick_query(run, thread);
+        uint64_t begin, done;
+
+        begin = now_ns();
+        if (begin >= run->end) {
+            /* over capacity: the queries still due never started */
+            if (interval > 0) {
+                thread->missed += (run->end - intended + interval - 1) /
+                                  interval;
+            }
+            break;
+        }
+        if (interval > 0 && begin < intended) {
+            sleep_until(intended);
+            begin = now_ns();
+        } else if (interval == 0) {
+            intended = begin;
+        }
+
+        set = table_set_pin(&run->domain, thread_index);
+        thread->checksum += run_query(thread, set, kind);
+        table_set_unpin(&run->domain, thread_index);
+
+        done = now_ns();
+        record_latency(&thread->corrected, done - intended);
+        record_latency(&thread->service, done - begin);
+        thread->queries[kind]++;
+
+        /* the schedule does not move when a query is late */
+        intended += interval;
+    }
+
+    return;
+}
+
+/*
+ * Parse a query mix (eg.: count=1,list=1,validate=4,sample=4,guess=1)
+ *
+ * \return returns 0 on success, -1 on syntax error
+ */
+static int parse_mix(const char *spec, int weights[])
+{
+    char name[16];
+    int weight, consumed, kind;
+
+    for (kind = 0; kind < QUERY_KINDS; kind++) {
+        weights[kind] = 0;
+    }
+
+    while (*spec != '\0') {
+        if (sscanf(spec, "%15[a-z]=%d%n", name, &weight, &consumed) != 2 ||
+            weight < 0)
+        {
+            return -1;
+        }
+        for (kind = 0; kind < QUERY_KINDS; kind++) {
+            if (strcmp(name, query_names[kind]) == 0) {
+                weights[kind] = weight;
+                break;
+            }
+        }
+        if (kind == QUERY_KINDS) {
+            return -1;
+        }
+        spec += consumed;
+        if (*spec == ',') {
+            spec++;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Run the queries at one rate and print the latencies
+ */
+static void run_rate(struct load_run *run, const double rate,
+                     const double seconds)
+{
+    struct latency_histogram *corrected, *service;
+    uint64_t queries[QUERY_KINDS] = { 0 };
+    uint64_t total = 0;
+    uint64_t missed = 0;
+    double elapsed;
+    int t, kind;
+
+    corrected = calloc(1, sizeof(struct latency_histogram));
+    service = calloc(1, sizeof(struct latency_histogram));
+    if (corrected == NULL || service == NULL) {
+        free(corrected);
+        free(service);
+        fprintf(stderr, "Not enough memory for the histograms!\n");
+        return;
+    }
+
+    memset(run->threads, 0, run->thread_count * sizeof(struct load_thread));
+    for (t = 0; t < run->thread_count; t++) {
+        run->threads[t].arena = scratch_arena(t);
+        run->threads[t].random = 0x9e3779b97f4a7c15ULL * (t + 1);
+    }
+    run->rate = rate;
+    run->reloads = 0;
+    run->start = now_ns();
+    run->end = run->start + (uint64_t)(seconds * 1e9);
+
+    run_parallel(run->thread_count + (run->reload ? 1 : 0), load_worker, run);
+    elapsed = (now_ns() - run->start) * 1e-9;
+    table_set_reclaim(&run->domain);
+
+    for (t = 0; t < run->thread_count; t++) {
+        merge_histogram(corrected, &run->threads[t].corrected);
+        merge_histogram(service, &run->threads[t].service);
+        missed += run->threads[t].missed;
+        for (kind = 0; kind < QUERY_KINDS; kind++) {
+            queries[kind] += run->threads[t].queries[kind];
+        }
+    }
+    total = corrected->count;
+
+    printf("%10.0f %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %7lu %8lu\n",
+           rate, total / elapsed,
+           latency_percentile(corrected, 0.5) * 1e-3,
+           latency_percentile(corrected, 0.9) * 1e-3,
+           latency_percentile(corrected, 0.99) * 1e-3,
+           latency_percentile(corrected, 0.999) * 1e-3,
+           corrected->max * 1e-3,
+           latency_percentile(service, 0.99) * 1e-3, run->reloads,
+           (unsigned long)missed);
+
+    free(corrected);
+    free(service);
+
+    return;
+}
+
+static void print_usage(const char *argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [-t THREADS] [-r RATES] [-d SECONDS] [-m MIX] [-l]\n"
+            "   -t\tNumber of query THREADS. (default: %d)\n"
+            "   -r\tComma separated target RATES in queries per second, at\n"
+            "     \tmost %d, 0 for back to back queries. (default: %s)\n"
+            "   -d\tSECONDS to run every rate for. (default: %.0f)\n"
+            "   -m\tQuery MIX weights. (default: count=1,list=1,\n"
+            "     \tvalidate=4,sample=4,guess=1)\n"
+            "   -l\tPublish a new table set every 10 ms while running.\n",
+            argv0, LOAD_THREADS, MAX_RATES, LOAD_RATES, LOAD_SECONDS);
+
+    return;
+}
+
+int main(int argc, char *argv[])
+{
+    struct load_run *run;
+    struct table_set *set;
+    double rates[MAX_RATES];
+    double seconds = LOAD_SECONDS;
+    const char *rate_list = LOAD_RATES;
+    const char *mix = "count=1,list=1,validate=4,sample=4,guess=1";
+    char *end;
+    int rate_count = 0;
+    int thread_count = LOAD_THREADS;
+    int reload = 0;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "t:r:d:m:l")) != -1) {
+        switch (opt) {
+        case 't':
+            thread_count = atoi(optarg);
+            break;
+        case 'r':
+            rate_list = optarg;
+            break;
+        case 'd':
+            seconds = atof(optarg);
+            break;
+        case 'm':
+            mix = optarg;
+            break;
+        case 'l':
+            reload = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* one thread is kept for the reloads */
+    if (thread_count < 1 || thread_count > MAX_THREADS - 1 ||
+        seconds <= 0)
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    while (*rate_list != '\0') {
+        if (rate_count == MAX_RATES) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        rates[rate_count] = strtod(rate_list, &end);
+        if (end == rate_list || rates[rate_count] < 0 ||
+            (*end != ',' && *end != '\0'))
+        {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        rate_count++;
+        rate_list = (*end == ',') ? end + 1 : end;
+    }
+
+    run = calloc(1, sizeof(struct load_run));
+    if (run == NULL || parse_mix(mix, run->weights) < 0) {
+        free(run);
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < QUERY_KINDS; i++) {
+        run->weight_total += run->weights[i];
+    }
+    run->threads = malloc(thread_count * sizeof(struct load_thread));
+    set = build_table_set(pattern_block_matrix, NULL, NULL);
+    if (run->weight_total == 0 || run->threads == NULL || set == NULL) {
+        fprintf(stderr, "Invalid mix or not enough memory!\n");
+        free(run->threads);
+        free(run);
+        free_table_set(set);
+        return EXIT_FAILURE;
+    }
+    init_table_domain(&run->domain, set);
+    run->thread_count = thread_count;
+    run->reload = reload;
+
+    printf("Latencies in us from the intended start of the queries, p99 "
+           "service time\nwithout the correction for comparison\n");
+    printf("%10s %10s %9s %9s %9s %9s %9s %9s %7s %8s\n", "target/s",
+           "achieved/s", "p50", "p90", "p99", "p99.9", "max", "svc p99",
+           "reloads", "missed");
+    for (i = 0; i < rate_count; i++) {
+        run_rate(run, rates[i], seconds);
+        fflush(stdout);
+    }
+
+    free_table_domain(&run->domain);
+    for (i = 0; i < thread_count; i++) {
+        arena_free(scratch_arena(i));
+    }
+    free(run->threads);
+    free(run);
+    return EXIT_SUCCESS;
+}
@@ -47,69 +47,135 @@
  *
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
 
-/* Number of points in the pattern which 
- * (it is also the maximum depth for the tree) */
-#define MAX_POINTS 9
-
-/* Node for the pattern tree */
-struct tree_node {
-    int id;
-    int child_count;
-    struct tree_node *parent_node;
-    struct tree_node *child_nodes[MAX_POINTS];
+#include "arena.h"
+#include "bucket.h"
+#include "corpus.h"
+#include "dense.h"
+#include "dump.h"
+#include "hamilton.h"
+#include "hash.h"
+#include "meter.h"
+#include "normalize.h"
+#include "order.h"
+#include "parallel.h"
+#include "probes.h"
+#include "pattern.h"
+#include "policy.h"
+#include "rules.h"
+#include "shape.h"
+#include "shuffle.h"
+#include "sort.h"
+#include "suffix.h"
+#include "table.h"
+#include "tables.h"
+#include "topk.h"
+#include "visitor.h"
+#include "writer.h"
+
+/* Options of the pattern file output */
+struct output_options {
+    struct pattern_filter filter;
+    struct sort_order sort_order;
+    int canonical;
+    int thread_count;
+    const struct pattern_hash *hash;
+    const char *salt;
+    const char *bucket_directory;
+    FILE *dump_file;
+    size_t block_budget;
 };
 
-/* Matrix describing which transition is blocked by which node */
-int pattern_block_matrix[10][10] = {
-   /*0, 1, 2, 3, 4, 5, 6, 7, 8, 9 */
-    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 0 */
-    {0, 0, 0, 2, 0, 0, 0, 4, 0, 5}, /* 1 */
-    {0, 0, 0, 0, 0, 0, 0, 0, 5, 0}, /* 2 */
-    {0, 2, 0, 0, 0, 0, 0, 5, 0, 6}, /* 3 */
-    {0, 0, 0, 0, 0, 0, 5, 0, 0, 0}, /* 4 */
-    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 5 */
-    {0, 0, 0, 0, 5, 0, 0, 0, 0, 0}, /* 6 */
-    {0, 4, 0, 5, 0, 0, 0, 0, 0, 8}, /* 7 */
-    {0, 0, 5, 0, 0, 0, 0, 0, 0, 0}, /* 8 */
-    {0, 5, 0, 6, 0, 0, 0, 8, 0, 0}, /* 9 */
-};
 
 /* Matrix describing which transition is blocked by which node for guessing */
 int guess_matrix[10][10];
 
 void print_help(const char* argv0);
-void init_subnode_list(struct tree_node *node);
-void add_subnodes(struct tree_node *parent_node, const int level, 
-                  int block_matrix[][10]);
-void delete_subtree(struct tree_node *node);
-int illegal_transition(const int parent_id, const int child_id, 
-                       const int branch_ids[], const int level,
-                       int block_matrix[][10]);
-void count_valid_patterns(const struct tree_node *const root, 
-                          int pattern_count[], const int level);
-void subtree_to_file(const struct tree_node * const node, 
-                     FILE* const output_file);
-void print_summary(const struct tree_node * const root_node);
-void print_random_patterns(const struct tree_node * const root_node, int len);
+void print_summary(const int pattern_count[]);
+void print_statistics(const struct score_histogram *scores,
+                      const struct feature_histogram *features);
+void print_random_patterns(const struct transition_table *transitions,
+                           int len);
+int print_validation(const char *pattern_string);
+int print_normalized_patterns(int block_matrix[][10]);
+int print_strength_meter(const char *pattern_string);
+int print_dense_ids(int block_matrix[][10],
+                    const struct pattern_filter *filter);
+void print_shuffled_patterns(int block_matrix[][10],
+                             const struct pattern_filter *filter,
+                             const unsigned long count, const uint64_t key);
+int print_corpus_analysis(const char *path, const int thread_count);
+int print_dump_query(const char *path, const struct pattern_filter *filter,
+                     FILE* const output_file, const int thread_count);
+int print_top_patterns(int block_matrix[][10],
+                       const struct pattern_filter *filter, const size_t k,
+                       const struct pattern_scorer *scorer,
+                       const int thread_count);
+void print_shape_counts(const int grid_size, const int max_length,
+                        FILE* const output_file);
+void print_arena_stats(void);
 void fill_guess_matrix(char* nodelist, int block_matrix[][10]);
 void disable_guess_edge(char* edge, int block_matrix[][10]);
+void print_table_analytics(int block_matrix[][10],
+                           const struct pattern_filter *filter,
+                           const int thread_count);
+void write_sorted_patterns(int block_matrix[][10],
+                           const struct output_options *options,
+                           FILE* const output_file);
+void write_canonical_patterns(int block_matrix[][10],
+                              const struct output_options *options,
+                              FILE* const output_file);
+void pattern_pass(int block_matrix[][10],
+                  const struct output_options *options,
+                  FILE* const output_file, int pattern_count[],
+                  struct score_histogram *scores,
+                  struct feature_histogram *features);
 
 /*
  * Main function, program entry.
  */
 int main(int argc, char *argv[])
 {
-    struct tree_node *root_node;
-    struct tree_node *guess_root_node;
+    int pattern_count[MAX_POINTS];
+    struct score_histogram scores;
+    struct feature_histogram features;
     int opt;
     int summary_flag = 0;
     int guess_flag = 0;
     int gen_pattern_len = 0;
+    int analytics_flag = 0;
+    int stats_flag = 0;
+    int edge_flag = 0;
+    int exit_code = EXIT_SUCCESS;
+    unsigned int guess_dots = 0;
+    char *validate_pattern = NULL;
+    int normalize_flag = 0;
+    int dense_flag = 0;
+    int stream_flag;
+    char *meter_pattern = NULL;
+    char *corpus_path = NULL;
+    char *query_path = NULL;
+    unsigned long top_count = 0;
+    const struct pattern_scorer *top_scorer = find_pattern_scorer("score");
+    int shape_grid = 0;
+    int shape_length = 0;
+    int arena_stats_flag = 0;
+    struct scratch_arena *arena = scratch_arena(0);
+    char *salt;
+    struct drawing_rule rule;
+    struct subpattern_policy policy;
+    int rule_flag = 0;
+    int policy_flag = 0;
+    int shuffle_flag = 0;
+    unsigned long shuffle_count = 0;
+    uint64_t shuffle_key = (uint64_t)time(NULL);
+    struct output_options output;
     FILE *pattern_file = NULL;
     char *guess_node_list = NULL;
     int i, j;
@@ -125,8 +191,20 @@ int main(int argc, char *argv[])
         }
     }
 
+    init_pattern_filter(&output.filter);
+    output.sort_order.key_count = 0;
+    output.canonical = 0;
+    output.thread_count = default_thread_count();
+    output.hash = NULL;
+    output.salt = "";
+    output.bucket_directory = NULL;
+    output.dump_file = NULL;
+    output.block_budget = 0;
+
     /* parse arguments */
-    while((opt = getopt(argc, argv, "sr:o:g:e:h")) != -1) {
+    while((opt = getopt(argc, argv,
+                        "sr:o:b:w:q:g:e:v:ndm:p:k:c:T:aSVR:F:t:f:O:lM:H:h"))
+          != -1) {
         switch (opt) {
         case 's':
             summary_flag = 1;
@@ -146,14 +224,146 @@ int main(int argc, char *argv[])
                 optarg);
             }
             break;
+        case 'b':
+            output.bucket_directory = optarg;
+            break;
+        case 'w':
+            output.dump_file = create_dump(optarg);
+            if (output.dump_file == NULL) {
+                fprintf(stderr, "Could not open \"%s\" dump file for writing\n",
+                        optarg);
+            }
+            break;
+        case 'q':
+            query_path = optarg;
+            break;
         case 'g':
             guess_flag = 1;
             fill_guess_matrix(optarg, guess_matrix);
             guess_node_list = optarg;
+            for (i = 0; optarg[i] != '\0'; i++) {
+                if (optarg[i] >= '1' && optarg[i] <= '0' + MAX_POINTS) {
+                    guess_dots |= DOT_BIT(optarg[i] - '0');
+                }
+            }
             break;
         case 'e':
+            edge_flag = 1;
             disable_guess_edge(optarg, guess_matrix);
             break;
+        case 'v':
+            validate_pattern = optarg;
+            break;
+        case 'n':
+            normalize_flag = 1;
+            break;
+        case 'd':
+            dense_flag = 1;
+            break;
+        case 'm':
+            meter_pattern = optarg;
+            break;
+        case 'c':
+            corpus_path = optarg;
+            break;
+        case 'T':
+            if (parse_shape_grid(optarg, &shape_grid, &shape_length) < 0) {
+                fprintf(stderr, "Invalid grid \"%s\"! (2-%d points per side, "
+                        "length up to SIZE*SIZE)\n", optarg, MAX_SHAPE_GRID);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'a':
+            analytics_flag = 1;
+            break;
+        case 'S':
+            stats_flag = 1;
+            break;
+        case 'V':
+            arena_stats_flag = 1;
+            break;
+        case 'p':
+            shuffle_flag = 1;
+            shuffle_count = strtoul(optarg, &salt, 10);
+            if (*salt == ':') {
+                shuffle_key = parse_shuffle_key(salt + 1);
+            } else if (*salt != '\0') {
+                fprintf(stderr, "Invalid parameter %s for -p flag!\n",
+                        optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            top_count = strtoul(optarg, &salt, 10);
+            if (*salt == ':') {
+                top_scorer = find_pattern_scorer(salt + 1);
+            }
+            if (top_count == 0 || top_scorer == NULL ||
+                (*salt != ':' && *salt != '\0'))
+            {
+                fprintf(stderr, "Invalid parameter %s for -k flag!\n",
+                        optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'R':
+            if (parse_drawing_rule(optarg, &rule) < 0) {
+                fprintf(stderr, "Invalid rule \"%s\"!\n", optarg);
+                return EXIT_FAILURE;
+            }
+            rule_flag++;
+            break;
+        case 'F':
+            if (parse_subpattern_policy(optarg, &policy) < 0) {
+                fprintf(stderr, "Invalid policy \"%s\"!\n", optarg);
+                return EXIT_FAILURE;
+            }
+            init_policy_rule(&policy, &rule);
+            rule_flag++;
+            policy_flag = 1;
+            break;
+        case 't':
+            if(atoi(optarg) > 0) {
+                output.thread_count = atoi(optarg);
+            } else {
+                fprintf(stderr, "Invalid parameter %s for -t flag!", optarg);
+            }
+            break;
+        case 'f':
+            if (parse_pattern_filter(optarg, &output.filter) < 0) {
+                fprintf(stderr, "Invalid filter \"%s\"!\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'O':
+            if (parse_sort_order(optarg, &output.sort_order) < 0) {
+                fprintf(stderr, "Invalid sort order \"%s\"!\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            output.canonical = 1;
+            break;
+        case 'M':
+            if (atoi(optarg) > 0) {
+                output.block_budget = (size_t)atoi(optarg) << 20;
+            } else {
+                fprintf(stderr, "Invalid parameter %s for -M flag!\n",
+                        optarg);
+            }
+            break;
+        case 'H':
+            salt = strchr(optarg, ':');
+            if (salt != NULL) {
+                *salt = '\0';
+                output.salt = salt + 1;
+            }
+            output.hash = find_pattern_hash(optarg);
+            if (output.hash == NULL) {
+                fprintf(stderr, "Unknown hash \"%s\"!\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
         case 'h':
         default:
             print_help(argv[0]);
@@ -161,61 +371,187 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (summary_flag > 0 || pattern_file != NULL  || gen_pattern_len > 0) {
-        /* init root node, not part of the unlock pattern */
-        root_node = malloc(sizeof(struct tree_node));
-        root_node->id = 0;
-        root_node->parent_node = root_node;
-        init_subnode_list(root_node);
+    if (rule_flag > 1) {
+        fprintf(stderr, "Only one of -R and -F can be used!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the policy only applies to the -o listing and the counts */
+    if (policy_flag > 0 && (output.bucket_directory != NULL ||
+                            output.dump_file != NULL || stats_flag > 0))
+    {
+        fprintf(stderr, "-F cannot be used with -b, -w or -S!\n");
+        return EXIT_FAILURE;
+    }
 
-        /* build the entire valid pattern tree */
-        add_subnodes(root_node, 0, pattern_block_matrix);
+    /* a second pass would overwrite the files and index of the first */
+    if (output.bucket_directory != NULL && summary_flag > 0 &&
+        guess_flag > 0)
+    {
+        fprintf(stderr, "Only one of -s and -g can be used with -b!\n");
+        return EXIT_FAILURE;
+    }
 
-        if (summary_flag > 0) {
-            print_summary(root_node);
-            if (pattern_file != NULL) {
-                fprintf(pattern_file, "Patterns based on all nodes\n");
-                subtree_to_file(root_node, pattern_file);
+    if (summary_flag > 0) {
+        /* counts of the full grid are precomputed at build time */
+        embedded_subset_lengths(MASK_COUNT - 1, pattern_count);
+        if (pattern_file != NULL) {
+            fprintf(pattern_file, "Patterns based on all nodes\n");
+        }
+        pattern_pass(pattern_block_matrix, &output,
+                     policy_flag > 0 ? NULL : pattern_file, NULL,
+                     stats_flag > 0 ? &scores : NULL,
+                     stats_flag > 0 ? &features : NULL);
+        if (policy_flag > 0 && pattern_file != NULL) {
+            if (list_with_rule(pattern_block_matrix, &rule, &output.filter,
+                               pattern_file, arena) < 0)
+            {
+                fprintf(stderr, "Not enough memory for listing!\n");
             }
+            arena_reset(arena);
+        }
+        if (rule_flag > 0) {
+            if (count_with_rule(pattern_block_matrix, &rule, pattern_count,
+                                NULL, arena) < 0)
+            {
+                fprintf(stderr, "Not enough memory for counting!\n");
+            }
+            arena_reset(arena);
         }
 
-        if (gen_pattern_len > 0) {
-            print_random_patterns(root_node, gen_pattern_len);
+        print_summary(pattern_count);
+        if (stats_flag > 0) {
+            print_statistics(&scores, &features);
         }
+    }
 
-        /* clean up */
-        delete_subtree(root_node);
-        free(root_node);
+    if (gen_pattern_len > 0) {
+        print_random_patterns(&embedded_rank_table.transitions,
+                              gen_pattern_len);
     }
 
-    if(guess_flag > 0) {
-        /* init root node, not part of the unlock pattern */
-        guess_root_node = malloc(sizeof(struct tree_node));
-        guess_root_node->id = 0;
-        guess_root_node->parent_node = guess_root_node;
-        init_subnode_list(guess_root_node);
+    if (validate_pattern != NULL) {
+        exit_code = print_validation(validate_pattern);
+    }
 
-        /* build the valid pattern tree based on available nodes */
-        add_subnodes(guess_root_node, 0, guess_matrix);
+    if (meter_pattern != NULL &&
+        print_strength_meter(meter_pattern) != EXIT_SUCCESS)
+    {
+        exit_code = EXIT_FAILURE;
+    }
 
-        /* print the summary */
-        print_summary(guess_root_node);
+    if (normalize_flag > 0 &&
+        print_normalized_patterns(guess_flag > 0 ? guess_matrix :
+                                  pattern_block_matrix) < 0)
+    {
+        exit_code = EXIT_FAILURE;
+    }
 
+    /* with a pattern or id stream on stdout -g only supplies the nodes, so
+     * the guess pass only runs for its files and prints no summary */
+    stream_flag = normalize_flag > 0 || dense_flag > 0 || shuffle_flag > 0 ||
+                  top_count > 0;
+    if (guess_flag > 0 && (stream_flag == 0 || pattern_file != NULL ||
+                           output.bucket_directory != NULL ||
+                           output.dump_file != NULL))
+    {
         if (pattern_file != NULL) {
             fprintf(pattern_file, "Guessed patterns based on nodes: %s\n",
                     guess_node_list);
-            subtree_to_file(guess_root_node, pattern_file);
         }
 
-        /* clean up */
-        delete_subtree(guess_root_node);
-        free(guess_root_node);
+        /* disabled edges are not covered by the precomputed counts, so
+         * those are counted in the same pass as the output is written */
+        pattern_pass(guess_matrix, &output,
+                     policy_flag > 0 ? NULL : pattern_file,
+                     (edge_flag > 0 && rule_flag == 0) ? pattern_count : NULL,
+                     stats_flag > 0 ? &scores : NULL,
+                     stats_flag > 0 ? &features : NULL);
+        if (policy_flag > 0 && pattern_file != NULL) {
+            if (list_with_rule(guess_matrix, &rule, &output.filter,
+                               pattern_file, arena) < 0)
+            {
+                fprintf(stderr, "Not enough memory for listing!\n");
+            }
+            arena_reset(arena);
+        }
+        if (rule_flag > 0) {
+            if (count_with_rule(guess_matrix, &rule, pattern_count,
+                                NULL, arena) < 0)
+            {
+                fprintf(stderr, "Not enough memory for counting!\n");
+            }
+            arena_reset(arena);
+        } else if (edge_flag == 0) {
+            embedded_subset_lengths(guess_dots, pattern_count);
+        }
+
+        /* print the summary */
+        if (stream_flag == 0) {
+            print_summary(pattern_count);
+            if (stats_flag > 0) {
+                print_statistics(&scores, &features);
+            }
+        }
+    }
+
+    if (dense_flag > 0 &&
+        print_dense_ids(guess_flag > 0 ? guess_matrix : pattern_block_matrix,
+                        &output.filter) < 0)
+    {
+        exit_code = EXIT_FAILURE;
+    }
+
+    if (query_path != NULL &&
+        print_dump_query(query_path, &output.filter,
+                         summary_flag == 0 && guess_flag == 0 ?
+                         pattern_file : NULL, output.thread_count) < 0)
+    {
+        exit_code = EXIT_FAILURE;
+    }
+
+    if (corpus_path != NULL &&
+        print_corpus_analysis(corpus_path, output.thread_count) < 0)
+    {
+        exit_code = EXIT_FAILURE;
     }
 
+    if (shape_grid > 0) {
+        print_shape_counts(shape_grid, shape_length, pattern_file);
+    }
+
+    if (shuffle_flag > 0) {
+        print_shuffled_patterns(guess_flag > 0 ? guess_matrix :
+                                pattern_block_matrix, &output.filter,
+                                shuffle_count, shuffle_key);
+    }
+
+    if (top_count > 0 &&
+        print_top_patterns(guess_flag > 0 ? guess_matrix :
+                           pattern_block_matrix, &output.filter, top_count,
+                           top_scorer, output.thread_count) < 0)
+    {
+        exit_code = EXIT_FAILURE;
+    }
+
+    if (analytics_flag > 0) {
+        print_table_analytics(guess_flag > 0 ? guess_matrix :
+                              pattern_block_matrix, &output.filter,
+                              output.thread_count);
+    }
+
+    if (arena_stats_flag > 0) {
+        print_arena_stats();
+    }
+    arena_free(arena);
+
+    if (output.dump_file != NULL) {
+        fclose(output.dump_file);
+    }
     if (pattern_file != NULL) {
         fclose(pattern_file);
     }
-    return EXIT_SUCCESS;
+    return exit_code;
 }
 /*
  * Print help and usage information for the user.
@@ -227,7 +563,12 @@ void print_help(const char* argv0)
     fprintf(stderr,
             "This software is provided under the 3-clause BSD license.\n\n");
     fprintf(stderr,
-            "Usage: %s [-s] [-r LENGTH] [-o FILE] [-g NODES] [-e EDGE] [-h]\n",
+            "Usage: %s [-s] [-r LENGTH] [-o FILE] [-b DIR] [-w DUMP]\n"
+            "       [-q DUMP] [-g NODES] [-e EDGE] [-v PATTERN] [-m PATTERN]\n"
+            "       [-n] [-d] [-p COUNT[:KEY]] [-k K[:SCORER]] [-c CORPUS]\n"
+            "       [-T SIZE[:MAXLEN]] [-a] [-S] [-V] [-R RULE] [-F LIST]\n"
+            "       [-f FILTER] [-O KEYS] [-l] [-M MIB] [-H HASH[:SALT]]\n"
+            "       [-t THREADS] [-h]\n",
             argv0);
     fprintf(stderr, "\n");
     fprintf(stderr,
@@ -236,10 +577,81 @@ void print_help(const char* argv0)
             "   -r\tGenerate random unlock patterns with given LENGTH.\n");
     fprintf(stderr,
             "   -o\tOutput patterns to file. Can be used with -s and -g.\n");
+    fprintf(stderr,
+            "   -b\tOutput patterns into one file per dot set in DIR, with\n"
+            "     \tan index.txt of the counts. Can be used with -s or -g.\n");
+    fprintf(stderr,
+            "   -w\tOutput packed patterns into a binary DUMP. Can be used\n"
+            "     \twith -s and -g.\n");
+    fprintf(stderr,
+            "   -q\tPrint the counts of the patterns of a DUMP matching -f,\n"
+            "     \tand write them with -o unless used with -s or -g.\n");
     fprintf(stderr,
             "   -g\tGuess patterns based on the NODES. (eg.: 73652)\n");
     fprintf(stderr,
             "   -e\tEdge not to include while guessing. (eg.: 12)\n");
+    fprintf(stderr,
+            "   -v\tValidate PATTERN and print its rank and score.\n");
+    fprintf(stderr,
+            "   -m\tPrint the score, the best reachable score and the number\n"
+            "     \tof longer patterns after every dot of PATTERN.\n");
+    fprintf(stderr,
+            "   -n\tNormalize intended dot sequences read from standard\n"
+            "     \tinput to the patterns drawn, with the auto-connected\n"
+            "     \tdots. Sequences which can not be drawn are printed as\n"
+            "     \t!SEQUENCE. Can be used with -g and -e.\n");
+    fprintf(stderr,
+            "   -d\tConvert the patterns read from standard input to dense\n"
+            "     \tids of the -g nodes, -e edges and -f lengths, and #ID\n"
+            "     \tlines back to patterns.\n");
+    fprintf(stderr,
+            "   -p\tPrint COUNT distinct patterns in random order (0 for\n"
+            "     \tall), shuffled by KEY. Can be used with -g and -f.\n");
+    fprintf(stderr,
+            "   -k\tPrint the K best patterns by SCORER, ties in\n"
+            "     \tlexicographic order. Can be used with -g and -f.\n"
+            "     \tScorers: score (default), crossings, area\n");
+    fprintf(stderr,
+            "   -c\tPrint frequencies, top patterns and guessing coverage of\n"
+            "     \ta CORPUS file of observed patterns, one per line.\n");
+    fprintf(stderr,
+            "   -T\tCount the shapes of patterns up to MAXLEN on a SIZE x\n"
+            "     \tSIZE grid. Shapes are listed with their placements with\n"
+            "     \t-o.\n");
+    fprintf(stderr,
+            "   -a\tPrint analytics on the pattern table. Can be used with\n"
+            "     \t-g.\n");
+    fprintf(stderr,
+            "   -S\tPrint score and dot statistics with -s and -g.\n");
+    fprintf(stderr,
+            "   -V\tPrint heap use of the count, list and sample queries.\n");
+    fprintf(stderr,
+            "   -R\tCount -s and -g patterns under an extra drawing RULE.\n"
+            "     \tRules: none, no-uturn, max-turn=DEGREES\n");
+    fprintf(stderr,
+            "   -F\tCount -s and -g patterns without the sub-patterns in\n"
+            "     \tLIST, and with the ones prefixed by +. Only the allowed\n"
+            "     \tpatterns are written with -o. Cannot be used with -b,\n"
+            "     \t-w and -S. (eg.: 14789,123,+5)\n");
+    fprintf(stderr,
+            "   -f\tOnly use patterns matching FILTER for -a, -S, -p, -k,\n"
+            "     \t-q, -o, -b and -w.\n"
+            "     \t(eg.: len=6-9,start=1,end=9,has=5,not=37,turns=0-2,\n"
+            "     \tpath=4-8.5, path in dot distances)\n");
+    fprintf(stderr,
+            "   -O\tSort and group output by KEYS. (eg.: length,score)\n"
+            "     \tKeys: length, score, start, end, dots\n");
+    fprintf(stderr,
+            "   -l\tOutput patterns by length, then lexicographically.\n");
+    fprintf(stderr,
+            "   -M\tOutput patterns from subtree blocks cached in at most\n"
+            "     \tMIB megabytes. Ignored with -f, -O, -l and -H.\n");
+    fprintf(stderr,
+            "   -H\tOutput patterns with their HASH (sha1 or fnv1a),\n"
+            "     \toptionally prefixed by SALT. (eg.: sha1 gives gesture.key\n"
+            "     \tdigests)\n");
+    fprintf(stderr,
+            "   -t\tNumber of THREADS to use. (default: all processors)\n");
     fprintf(stderr,
             "   -h\tPrint this help message.\n");
 
@@ -247,245 +659,584 @@ void print_help(const char* argv0)
 }
 
 /*
- * Initialize subnode pointers to NULL
+ * Print summary of available patterns
  *
- * \param node Node to initialize
+ * \param pattern_count number of patterns for each length of patterns
  */
-void init_subnode_list(struct tree_node *node)
+void print_summary(const int pattern_count[])
 {
+    int sum = 0;
+    int valid_sum = 0;
     int i;
 
     for (i = 0; i < MAX_POINTS; i++) {
-        node->child_count = 0;
-        node->child_nodes[i] = NULL;
+        if(pattern_count[i] > 0) {
+            printf("Number of patterns for length %d: %d\t\
+                    Minutes to brute-force*: %d\n",
+                    i+1, pattern_count[i], pattern_count[i]/5);
+        }
+        sum += pattern_count[i];
+        if (i > 2) valid_sum += pattern_count[i];
     }
+    printf("-------------------------------------------\n");
+    printf("Number of all available patterns: %d\n", sum);
+    printf("Number of valid patterns (length >= 4): %d (Brute-force* %d mins)\n",
+            valid_sum, valid_sum/5);
+    printf("(* assuming 5 tries in 30 seconds and then a 30 second timeout, no limit on number of tires)\n");
 
     return;
 }
 
 /*
- * Add all possible subnodes
+ * Print score distribution and dot usage statistics
  *
- * \param parent_node parent node to add subnodes to
- * \param level level of the tree we are on
+ * \param scores number of patterns of every score
+ * \param features number of patterns starting, ending at and using dots
  */
-void add_subnodes(struct tree_node *parent_node, 
-                  const int level, int block_matrix[][10])
+void print_statistics(const struct score_histogram *scores,
+                      const struct feature_histogram *features)
 {
-    static int node_ids[MAX_POINTS]; /* keep track of the current branch */
-    int i, j;
-
-    for (i = 1; i <= MAX_POINTS; i++) {
-        char present = 0;
+    int i;
 
-        /* find if current node id is present on this branch */
-        for (j = 0; j < level; j++) {
-            if (i == node_ids[j]) {
-                present = 1;
-                break;
-            }
+    for (i = 0; i <= MAX_SCORE; i++) {
+        if (scores->count[i] > 0) {
+            printf("Number of patterns with score %d: %lu\n",
+                   i, (unsigned long)scores->count[i]);
         }
+    }
+    printf("-------------------------------------------\n");
+    for (i = 1; i <= MAX_POINTS; i++) {
+        printf("Dot %d: starts %lu\tends %lu\tused in %lu patterns\n", i,
+               (unsigned long)features->start[i],
+               (unsigned long)features->end[i],
+               (unsigned long)features->used[i]);
+    }
+    printf("Number of patterns analysed: %lu\n",
+           (unsigned long)features->patterns);
 
-        if ((present > 0) || 
-            (illegal_transition(parent_node->id, i, node_ids, 
-                                level, block_matrix) > 0))
-        {
-            continue;
-        }
+    return;
+}
 
-        /* save new node id */
-        node_ids[level] = i;
-        parent_node->child_nodes[parent_node->child_count] =
-            malloc(sizeof(struct tree_node));
-        parent_node->child_nodes[parent_node->child_count]->id = i;
-        parent_node->child_nodes[parent_node->child_count]->parent_node =
-            parent_node;
-        init_subnode_list(parent_node->child_nodes[parent_node->child_count]);
+/*
+ * Print 10 random unlock patterns of specified length
+ *
+ * \param transitions legal transitions of the pattern space
+ * \param len length of the patterns to print (minimum 4)
+ */
+void print_random_patterns(const struct transition_table *transitions,
+                           int len)
+{
+    int i;
+    int pattern_len;
+    unsigned int mask;
+    int last;
+    
+    if ((len < 4) || (len > 9)) {
+        fprintf(stderr, "%d is invalid pattern length. Must be 4-9!\n", len);
+    }
 
-        /* calculate subnodes for this child */
-        add_subnodes(parent_node->child_nodes[parent_node->child_count],
-                     level + 1, block_matrix);
-        parent_node->child_count++;
+    srand(time(NULL));
 
-        /* branch for this node is done, so remove it */
-        node_ids[level] = 0;
+    for(i = 0; i < 10; i++) {
+        pattern_len = 0;
+        mask = 0;
+        last = 0;
+        while (pattern_len < len && transitions->next[mask][last] != 0) {
+            uint16_t candidates = transitions->next[mask][last];
+            int dot = (int)(rand() % popcount_mask(candidates));
+
+            /* pick the dot-th legal child */
+            while (dot-- > 0) {
+                candidates &= candidates - 1;
+            }
+            last = __builtin_ctz(candidates) + 1;
+            mask |= DOT_BIT(last);
+            printf("%d", last);
+            pattern_len++;
+        }
+        printf("\n");
     }
 
     return;
 }
 
 /*
- * Delete entire subtree under the node
+ * Print whether a pattern can be drawn on the standard grid, and if so its
+ * rank and score.
  *
- * \param node The node under which the subtree must be deleted.
+ * \param pattern_string pattern to check (eg.: 14789)
+ * \return EXIT_SUCCESS if the pattern is valid, EXIT_FAILURE otherwise
  */
-void delete_subtree(struct tree_node *node)
+int print_validation(const char *pattern_string)
 {
-    int i;
+    packed_pattern_t pattern;
+    uint32_t rank;
 
-    for (i = 0; i < node->child_count; i++) {
-        delete_subtree(node->child_nodes[i]);
-        free(node->child_nodes[i]);
-        node->child_nodes[i] = NULL;
+    if (string_to_packed(pattern_string, &pattern) < 0 ||
+        pattern_valid(&embedded_rank_table.transitions, pattern) == 0)
+    {
+        printf("Pattern %s is invalid\n", pattern_string);
+        return EXIT_FAILURE;
     }
 
-    node->child_count = 0;
+    rank = pattern_rank(&embedded_rank_table, pattern);
+    printf("Pattern %s is valid (rank %lu of %lu, score %d)\n",
+           pattern_string, (unsigned long)rank,
+           (unsigned long)embedded_pattern_count, embedded_scores[rank]);
 
-    return;
+    return EXIT_SUCCESS;
 }
 
 /*
- * Function to decide whether it is an illegal transition on 
- * the current branch or not
+ * Print the best patterns under a scoring function
  *
- * \param parent_id Node ID of the parent
- * \param child_id Node ID of the child
- * \param branch_ids list of nodes on this branch
- * \param level length of the branch
- * \return returns 1 if illegal transition, 0 if legal
+ * \param block_matrix the transition matrix to use
+ * \param filter only patterns matching this filter are scored
+ * \param k number of patterns to print
+ * \param scorer scoring function
+ * \param thread_count number of threads to use
+ * \return returns 0 on success, -1 if out of memory
  */
-int illegal_transition(const int parent_id, 
-                       const int child_id,
-                       const int branch_ids[], 
-                       const int level,
-                       int block_matrix[][10])
+int print_top_patterns(int block_matrix[][10],
+                       const struct pattern_filter *filter, const size_t k,
+                       const struct pattern_scorer *scorer,
+                       const int thread_count)
 {
-    int blocker = block_matrix[parent_id][child_id];
-    int i;
-
-    /* legal transition if there is no blocker */
-    if (blocker == 0) {
-        return 0;
+    struct topk_query query;
+    struct constraint_ranks *ranks;
+    char line[MAX_POINTS + 1];
+    size_t i;
+
+    /* no more than the patterns of the grid and lengths can be selected */
+    ranks = malloc(sizeof(struct constraint_ranks));
+    if (ranks == NULL) {
+        fprintf(stderr, "Not enough memory for the top patterns!\n");
+        return -1;
+    }
+    build_constraint_ranks(block_matrix, filter->min_length,
+                           filter->max_length, ranks);
+    query.k = constraint_pattern_count(ranks);
+    free(ranks);
+    if (k < query.k) {
+        query.k = k;
     }
 
-    /* illegal transition because it is disabled */
-    if (blocker == -1)
-    {
-        return 1;
+    query.scorer = scorer;
+    query.filter = filter;
+    query.thread_count = thread_count;
+    if (select_top_patterns(block_matrix, &query) < 0) {
+        fprintf(stderr, "Not enough memory for the top patterns!\n");
+        return -1;
     }
 
-    for (i = 0; i < level; i++) {
-        /* if blocker node is already used then this transition is legal */
-        if (blocker == branch_ids[i])
-            return 0;
+    printf("Top %lu of %lu patterns by %s (%lu rejected early)\n",
+           (unsigned long)query.count, query.scored, scorer->name,
+           query.rejected);
+    for (i = 0; i < query.count; i++) {
+        packed_to_string(query.entries[i].pattern, line);
+        printf("%lu %s %d\n", (unsigned long)i + 1, line,
+               query.entries[i].score);
     }
 
-    return 1;
+    free(query.entries);
+    return 0;
 }
 
 /*
- * Count all valid android unlock patterns
+ * Run a filter over a binary dump and print the counts of the matching
+ * patterns
  *
- * \param root root of the pattern tree to walk through
- * \param pattern_count array to store the count for each length of patterns
- * \param level level of the current tree
+ * \param path dump file
+ * \param filter patterns to match
+ * \param output_file file to write the matching patterns to, NULL if none
+ * \param thread_count number of threads to use
+ * \return returns 0 on success, -1 on error
  */
-void count_valid_patterns(const struct tree_node *const root,
-                          int pattern_count[], 
-                          const int level)
+int print_dump_query(const char *path, const struct pattern_filter *filter,
+                     FILE* const output_file, const int thread_count)
 {
+    struct dump_query query;
     int i;
 
-    for (i = 0; i < root->child_count; i++) {
-        pattern_count[level] = pattern_count[level] + 1;
-        count_valid_patterns(root->child_nodes[i], pattern_count, level + 1);
+    query.filter = filter;
+    query.output_file = output_file;
+    query.thread_count = thread_count;
+    if (scan_dump(path, &query) < 0) {
+        fprintf(stderr, "Could not query \"%s\" dump file\n", path);
+        return -1;
     }
 
-    return;
+    printf("Patterns in dump: %lu\n", (unsigned long)query.records);
+    if (query.invalid > 0) {
+        printf("Invalid records skipped: %lu\n",
+               (unsigned long)query.invalid);
+    }
+    printf("Matching patterns: %lu\n", (unsigned long)query.matches);
+    for (i = 1; i <= MAX_POINTS; i++) {
+        if (query.length_matches[i] > 0) {
+            printf("Matching patterns of length %d: %lu\n", i,
+                   (unsigned long)query.length_matches[i]);
+        }
+    }
+    printf("Matching patterns by start dot:");
+    for (i = 1; i <= MAX_POINTS; i++) {
+        printf(" %lu", (unsigned long)query.start_matches[i]);
+    }
+    printf("\nMatching patterns by end dot:  ");
+    for (i = 1; i <= MAX_POINTS; i++) {
+        printf(" %lu", (unsigned long)query.end_matches[i]);
+    }
+    printf("\n");
+
+    return 0;
 }
 
 /*
- * Print (sub)patterns to file
+ * Show the feedback of the strength meter after every dot of a pattern, as
+ * a lock setup screen would while the pattern is drawn
+ *
+ * \param pattern_string the pattern
+ * \return returns EXIT_SUCCESS if every dot could be added
  */
-void subtree_to_file(const struct tree_node * const node, 
-                     FILE* const output_file)
+int print_strength_meter(const char *pattern_string)
 {
-    static int branch;
-    int i;
+    struct meter_table *table;
+    struct strength_meter meter;
+    char next_dots[MAX_POINTS + 1];
+    unsigned int next;
+    int i, n;
+
+    table = malloc(sizeof(struct meter_table));
+    if (table == NULL) {
+        fprintf(stderr, "Not enough memory for the meter table!\n");
+        return EXIT_FAILURE;
+    }
+    build_meter_table(&embedded_rank_table, table);
+    meter_reset(&meter, table);
+
+    for (i = 0; pattern_string[i] != '\0'; i++) {
+        if (meter_add(&meter, pattern_string[i] - '0') < 0) {
+            printf("Dot %c can not be added to %.*s\n", pattern_string[i],
+                   i, pattern_string);
+            free(table);
+            return EXIT_FAILURE;
+        }
 
-    if (branch == 0) {
-        branch = node->id;
+        for (n = 0, next = meter_next_dots(&meter); next != 0;
+             next &= next - 1)
+        {
+            next_dots[n++] = (char)('1' + __builtin_ctz(next));
+        }
+        next_dots[n] = '\0';
+
+        printf("%-9.*s score %2d, best %2d, %6lu longer patterns, "
+               "next dots %s\n", i + 1, pattern_string, meter.score,
+               meter_best_score(&meter),
+               (unsigned long)meter_completions(&meter),
+               n > 0 ? next_dots : "none");
     }
 
-    for(i = 0; i < node->child_count; i++) {
-        fprintf(output_file, "%d\n", (branch * 10) + node->child_nodes[i]->id);
+    free(table);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Convert the patterns of the standard input to their dense ids within a
+ * constraint set and ids prefixed with # back to patterns, one per line.
+ * Lines outside the set give "-".
+ *
+ * \param block_matrix the transition matrix of the allowed dots and edges
+ * \param filter the length range is taken from the filter
+ * \return returns 0 on success, -1 if out of memory
+ */
+int print_dense_ids(int block_matrix[][10],
+                    const struct pattern_filter *filter)
+{
+    struct constraint_ranks *ranks;
+    struct timespec start, end;
+    char *line = NULL;
+    size_t line_size = 0;
+    char pattern_string[MAX_POINTS + 1];
+
+    ranks = malloc(sizeof(struct constraint_ranks));
+    if (ranks == NULL) {
+        fprintf(stderr, "Not enough memory for the constraint ranks!\n");
+        return -1;
     }
 
-    for(i = 0; i < node->child_count; i++) {
-        branch = branch * 10 + node->child_nodes[i]->id;
-        subtree_to_file(node->child_nodes[i], output_file);
-        branch = branch / 10;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    build_constraint_ranks(block_matrix, filter->min_length,
+                           filter->max_length, ranks);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stderr, "Constraint set of %lu patterns, built in %.1f us\n",
+            (unsigned long)constraint_pattern_count(ranks),
+            (end.tv_sec - start.tv_sec) * 1e6 +
+            (end.tv_nsec - start.tv_nsec) * 1e-3);
+
+    /* whole lines of any length, so every input line gives one output line */
+    while (getline(&line, &line_size, stdin) >= 0) {
+        packed_pattern_t pattern = 0;
+        unsigned long id;
+        uint32_t rank;
+        char *id_end;
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '#') {
+            /* ids past the set, or out of range of strtoul, are no pattern */
+            errno = 0;
+            id = strtoul(line + 1, &id_end, 10);
+            if (line[1] >= '0' && line[1] <= '9' && *id_end == '\0' &&
+                errno != ERANGE && id < constraint_pattern_count(ranks))
+            {
+                pattern = constraint_unrank(ranks, (uint32_t)id);
+            }
+            if (pattern != 0) {
+                packed_to_string(pattern, pattern_string);
+                printf("%s\n", pattern_string);
+            } else {
+                printf("-\n");
+            }
+        } else if (string_to_packed(line, &pattern) == 0 &&
+                   constraint_rank(ranks, pattern, &rank) == 0)
+        {
+            printf("%lu\n", (unsigned long)rank);
+        } else {
+            printf("-\n");
+        }
     }
 
-    return;
+    free(line);
+    free(ranks);
+    return 0;
 }
 
 /*
- * Print summary of available patterns
+ * Normalize the intended dot sequences of the standard input and print the
+ * totals to the standard error
  *
- * \param root_node Root node of the pattern tree
+ * \param block_matrix the transition matrix to use
+ * \return returns 0 on success, -1 on error
  */
-void print_summary(const struct tree_node * const root_node)
+int print_normalized_patterns(int block_matrix[][10])
 {
-    int pattern_count[MAX_POINTS];
-    int sum = 0;
-    int valid_sum = 0;
-    int i;
+    struct normalize_table *table;
+    struct normalize_stats stats;
+    int r;
+
+    table = malloc(sizeof(struct normalize_table));
+    if (table == NULL) {
+        fprintf(stderr, "Not enough memory for the normalize table!\n");
+        return -1;
+    }
+    build_normalize_table(block_matrix, table);
+
+    r = normalize_stream(table, stdin, stdout, &stats);
+    if (r < 0) {
+        fprintf(stderr, "Could not read the dot sequences!\n");
+    } else {
+        fprintf(stderr, "Normalized %lu sequences, %lu with auto-connected "
+                "dots, %lu rejected\n", stats.lines, stats.changed,
+                stats.rejected);
+    }
 
-    for (i = 0; i < MAX_POINTS; i++) {
-        pattern_count[i] = 0;
+    free(table);
+    return r;
+}
+
+/*
+ * Print distinct patterns in a keyed random order. The ranks are walked
+ * through a pseudo-random permutation and unranked one by one, so no list of
+ * patterns is kept in memory.
+ *
+ * \param block_matrix the transition matrix to use
+ * \param filter only patterns matching this filter are printed
+ * \param count number of patterns to print, 0 for all
+ * \param key key of the permutation
+ */
+void print_shuffled_patterns(int block_matrix[][10],
+                             const struct pattern_filter *filter,
+                             const unsigned long count, const uint64_t key)
+{
+    struct scratch_arena *arena = scratch_arena(0);
+    struct rank_table *built_table;
+    const struct rank_table *table = &embedded_rank_table;
+    struct feistel_permutation perm;
+    unsigned long printed = 0;
+    uint64_t i;
+    char line[MAX_POINTS + 1];
+
+    /* the standard grid has its rank table built in */
+    if (block_matrix != pattern_block_matrix) {
+        built_table = arena_alloc(arena, sizeof(struct rank_table));
+        if (built_table == NULL) {
+            fprintf(stderr, "Not enough memory for the rank table!\n");
+            arena_reset(arena);
+            return;
+        }
+        build_rank_table(block_matrix, built_table);
+        table = built_table;
     }
 
-    count_valid_patterns(root_node, pattern_count, 0);
+    if (table->suffix[0][0] > 0) {
+        init_feistel_permutation(&perm, table->suffix[0][0], key);
 
-    for (i = 0; i < MAX_POINTS; i++) {
-        if(pattern_count[i] > 0) {
-            printf("Number of patterns for length %d: %d\t\
-                    Minutes to brute-force*: %d\n",
-                    i+1, pattern_count[i], pattern_count[i]/5);
+        for (i = 0; i < perm.domain && (count == 0 || printed < count); i++) {
+            packed_pattern_t pattern =
+                pattern_unrank(table, (uint32_t)feistel_permute(&perm, i));
+
+            if (pattern_filter_match(filter, pattern)) {
+                packed_to_string(pattern, line);
+                printf("%s\n", line);
+                printed++;
+            }
+            if ((i + 1) % PATTERN_BATCH_SIZE == 0) {
+                AUP_PROBE2(sample_batch, i + 1, printed);
+            }
         }
-        sum += pattern_count[i];
-        if (i > 2) valid_sum += pattern_count[i];
+        AUP_PROBE2(sample_batch, i, printed);
     }
-    printf("-------------------------------------------\n");
-    printf("Number of all available patterns: %d\n", sum);
-    printf("Number of valid patterns (length >= 4): %d (Brute-force* %d mins)\n",
-            valid_sum, valid_sum/5);
-    printf("(* assuming 5 tries in 30 seconds and then a 30 second timeout, no limit on number of tires)\n");
+
+    arena_reset(arena);
 
     return;
 }
 
 /*
- * Print 10 random unlock patterns of specified length
+ * Print the frequency analysis of a corpus of observed patterns: per length
+ * breakdown, the most frequent patterns and the share of the corpus covered
+ * by guessing the most frequent patterns first.
  *
- * \param root_node Root node of the pattern tree
- * \param len length of the patterns to print (minimum 4)
+ * \param path corpus file, one pattern per line
+ * \param thread_count number of threads to use
+ * \return returns 0 on success, -1 if the corpus could not be read
  */
-void print_random_patterns(const struct tree_node * const root_node, int len)
+int print_corpus_analysis(const char *path, const int thread_count)
 {
-    int i;
-    int pattern_len;
-    const struct tree_node * current_node = root_node;
-    
-    if ((len < 4) || (len > 9)) {
-        fprintf(stderr, "%d is invalid pattern length. Must be 4-9!\n", len);
+    static const uint32_t guesses[] = { 1, 5, 10, 20, 100, 1000, 10000 };
+    struct corpus_stats stats;
+    uint32_t *order;
+    uint64_t valid, covered = 0;
+    uint32_t i, g = 0;
+    char line[MAX_POINTS + 1];
+
+    if (analyze_corpus(path, &embedded_rank_table, thread_count,
+                       &stats) < 0)
+    {
+        fprintf(stderr, "Could not read \"%s\" corpus file\n", path);
+        return -1;
+    }
+    order = corpus_frequency_order(&stats);
+    if (order == NULL) {
+        fprintf(stderr, "Not enough memory for the corpus analysis!\n");
+        free_corpus_stats(&stats);
+        return -1;
     }
 
-    srand(time(NULL));
+    /* avoid dividing by zero for corpora without valid patterns */
+    valid = stats.lines - stats.invalid;
+    if (valid == 0) {
+        valid = 1;
+    }
+    printf("Number of corpus lines: %lu (invalid: %lu)\n",
+           (unsigned long)stats.lines, (unsigned long)stats.invalid);
+    printf("Number of distinct patterns: %lu of %lu\n",
+           (unsigned long)stats.distinct, (unsigned long)stats.pattern_count);
+    for (i = 1; i <= MAX_POINTS; i++) {
+        if (stats.length_lines[i] > 0) {
+            printf("Length %u: %lu observed (%.2f%%)\t%lu distinct of %lu\n",
+                   i, (unsigned long)stats.length_lines[i],
+                   100.0 * stats.length_lines[i] / valid,
+                   (unsigned long)stats.length_distinct[i],
+                   (unsigned long)embedded_length_count[i]);
+        }
+    }
 
-    for(i = 0; i < 10; i++) {
-        pattern_len = 0;
-        current_node = root_node;
-        while (pattern_len < len) {
-            int dot = (int)(rand() % current_node->child_count);
-            printf("%d", current_node->child_nodes[dot]->id);
-            current_node = current_node->child_nodes[dot];
-            pattern_len++;
+    printf("-------------------------------------------\n");
+    for (i = 0; i < stats.distinct && i < CORPUS_TOP_COUNT; i++) {
+        packed_to_string(pattern_unrank(&embedded_rank_table, order[i]),
+                         line);
+        printf("%2u. %-9s %lu (%.2f%%)\n", i + 1, line,
+               (unsigned long)stats.frequency[order[i]],
+               100.0 * stats.frequency[order[i]] / valid);
+    }
+
+    printf("-------------------------------------------\n");
+    for (i = 0; i < stats.distinct; i++) {
+        covered += stats.frequency[order[i]];
+        if (i + 1 == stats.distinct ||
+            (g < sizeof(guesses) / sizeof(guesses[0]) && i + 1 == guesses[g]))
+        {
+            printf("Corpus covered by %u guesses: %.2f%%\n", i + 1,
+                   100.0 * covered / valid);
+            g++;
         }
-        printf("\n");
     }
 
+    free(order);
+    free_corpus_stats(&stats);
+
+    return 0;
+}
+
+/*
+ * Print the number of translation invariant shapes of every length on a
+ * square grid and the number of patterns they cover
+ *
+ * \param grid_size points per side of the grid
+ * \param max_length longest shape to count
+ * \param output_file file to list the shapes in, NULL for no listing
+ */
+void print_shape_counts(const int grid_size, const int max_length,
+                        FILE* const output_file)
+{
+    struct shape_counts counts;
+    uint64_t shapes = 0, classes = 0, patterns = 0;
+    int i;
+
+    if (output_file != NULL) {
+        fprintf(output_file, "Shapes on a %dx%d grid\n", grid_size,
+                grid_size);
+    }
+    if (count_shapes(grid_size, max_length, &counts, output_file) < 0) {
+        fprintf(stderr, "Not enough memory for counting shapes!\n");
+        return;
+    }
+
+    for (i = 1; i <= max_length; i++) {
+        printf("Number of shapes for length %d: %lu (%lu up to rotation and "
+               "reflection)\tpatterns: %lu\n", i,
+               (unsigned long)counts.shapes[i],
+               (unsigned long)counts.classes[i],
+               (unsigned long)counts.patterns[i]);
+        shapes += counts.shapes[i];
+        classes += counts.classes[i];
+        patterns += counts.patterns[i];
+    }
+    printf("-------------------------------------------\n");
+    printf("Number of shapes on a %dx%d grid: %lu (%lu up to rotation and "
+           "reflection)\n", grid_size, grid_size, (unsigned long)shapes,
+           (unsigned long)classes);
+    printf("Number of patterns covered: %lu\n", (unsigned long)patterns);
+
+    return;
+}
+
+/*
+ * Print the heap use of the query paths. Once the scratch arena is sized by
+ * the first query, later queries should not allocate at all.
+ */
+void print_arena_stats(void)
+{
+    struct arena_stats stats;
+
+    get_arena_stats(&stats);
+    printf("Number of queries: %lu\n", stats.queries);
+    printf("Heap allocations of queries: %lu (last query: %lu)\n",
+           stats.heap_allocations, stats.last_query_allocations);
+    printf("Scratch memory per query: %lu bytes\n",
+           (unsigned long)stats.high_water);
+
     return;
 }
 
@@ -556,3 +1307,357 @@ void disable_guess_edge(char* edge, int block_matrix[][10])
     return;
 }
 
+
+/*
+ * Print start, end and usage statistics of the dots, computed by column scans
+ * over a materialized pattern table.
+ *
+ * \param block_matrix the transition matrix to use
+ * \param filter only patterns matching this filter are analysed
+ * \param thread_count number of threads to build the table with
+ */
+void print_table_analytics(int block_matrix[][10],
+                           const struct pattern_filter *filter,
+                           const int thread_count)
+{
+    struct pattern_table table;
+    size_t count;
+    int i;
+
+    if (pattern_table_build(&table, block_matrix, filter, thread_count) < 0) {
+        fprintf(stderr, "Not enough memory for the pattern table!\n");
+        return;
+    }
+
+    printf("Number of patterns in table: %lu\n", (unsigned long)table.count);
+    for (i = 1; i <= MAX_POINTS; i++) {
+        count = pattern_table_count_eq(table.length, table.count, (uint8_t)i);
+        if (count > 0) {
+            printf("Number of patterns for length %d: %lu\n",
+                   i, (unsigned long)count);
+        }
+    }
+    printf("-------------------------------------------\n");
+    for (i = 1; i <= MAX_POINTS; i++) {
+        printf("Dot %d: starts %lu\tends %lu\tused in %lu patterns\n", i,
+               (unsigned long)pattern_table_count_eq(table.start,
+                                                     table.count, (uint8_t)i),
+               (unsigned long)pattern_table_count_eq(table.end,
+                                                     table.count, (uint8_t)i),
+               (unsigned long)pattern_table_count_used(&table, i));
+    }
+
+    pattern_table_free(&table);
+
+    return;
+}
+
+/*
+ * Write patterns to file ordered and grouped by a sort order. Every group of
+ * the first key gets its own section.
+ *
+ * \param block_matrix the transition matrix to use
+ * \param options filter, sort order and threads to use
+ * \param output_file file to write to
+ */
+void write_sorted_patterns(int block_matrix[][10],
+                           const struct output_options *options,
+                           FILE* const output_file)
+{
+    const struct sort_order *order = &options->sort_order;
+    struct pattern_table table;
+    packed_pattern_t *patterns;
+    size_t count;
+    size_t group_start[MAX_KEY_VALUES + 1];
+    unsigned int group_value[MAX_KEY_VALUES];
+    size_t groups, g, i;
+    char line[MAX_POINTS + 2];
+    int len;
+
+    if (pattern_table_build(&table, block_matrix, &options->filter,
+                            options->thread_count) < 0)
+    {
+        fprintf(stderr, "Not enough memory for the pattern table!\n");
+        return;
+    }
+
+    /* only the digits are needed, the other columns are not sorted */
+    patterns = table.digits;
+    count = table.count;
+    table.digits = NULL;
+    pattern_table_free(&table);
+
+    if (radix_sort_patterns(patterns, count, order,
+                            options->thread_count) < 0)
+    {
+        fprintf(stderr, "Not enough memory for sorting!\n");
+        free(patterns);
+        return;
+    }
+
+    groups = group_patterns(patterns, count, order->keys[0],
+                            group_start, group_value);
+    group_start[groups] = count;
+
+    for (g = 0; g < groups; g++) {
+        /* dot sets are shown as dot lists, like the patterns */
+        if (order->keys[0] == SORT_KEY_DOTS) {
+            mask_to_string(group_value[g], line);
+            fprintf(output_file, "Patterns with %s %s\n",
+                    sort_key_name(order->keys[0]), line);
+        } else {
+            fprintf(output_file, "Patterns with %s %u\n",
+                    sort_key_name(order->keys[0]), group_value[g]);
+        }
+        for (i = group_start[g]; i < group_start[g + 1]; i++) {
+            len = packed_to_string(patterns[i], line);
+            line[len] = '\n';
+            fwrite(line, 1, len + 1, output_file);
+        }
+    }
+
+    free(patterns);
+
+    return;
+}
+
+/* Destination of the patterns of the complete length generator */
+struct canonical_output {
+    FILE *output_file;
+    const struct pattern_filter *filter;
+};
+
+/*
+ * Write a buffer of generated patterns
+ */
+static void write_packed_patterns(void *ctx,
+                                  const packed_pattern_t *patterns,
+                                  const size_t count)
+{
+    struct canonical_output *output = ctx;
+    char text[HAMILTON_BUFFER_SIZE * (MAX_POINTS + 1)];
+    size_t len = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (pattern_filter_match(output->filter, patterns[i])) {
+            len += packed_to_string(patterns[i], text + len);
+            text[len++] = '\n';
+        }
+    }
+    fwrite(text, 1, len, output->output_file);
+
+    return;
+}
+
+/*
+ * Write patterns to file in length, then lexicographic order. The patterns
+ * are stepped through with next_pattern(), which also tells how much of the
+ * previous line can be kept. The longest patterns, most of the output, come
+ * from the complete length generator instead.
+ *
+ * \param block_matrix the transition matrix to use
+ * \param options only patterns matching the filter are written
+ * \param output_file file to write to
+ */
+void write_canonical_patterns(int block_matrix[][10],
+                              const struct output_options *options,
+                              FILE* const output_file)
+{
+    const struct pattern_filter *filter = &options->filter;
+    struct order_table *table;
+    struct hamilton_table *complete;
+    struct canonical_output output;
+    packed_pattern_t *buffer;
+    packed_pattern_t pattern;
+    char line[MAX_POINTS + 2];
+    int prefix_length = 0;
+    int max_length = filter->max_length > 0 ? filter->max_length : MAX_POINTS;
+    int len;
+
+    table = malloc(sizeof(struct order_table));
+    complete = malloc(sizeof(struct hamilton_table));
+    buffer = malloc(HAMILTON_BUFFER_SIZE * sizeof(packed_pattern_t));
+    if (table == NULL || complete == NULL || buffer == NULL) {
+        fprintf(stderr, "Not enough memory for the order table!\n");
+        free(table);
+        free(complete);
+        free(buffer);
+        return;
+    }
+    build_order_table(block_matrix, table);
+
+    pattern = first_pattern(table, filter->min_length > 0 ?
+                            filter->min_length : 1);
+    while (pattern != 0) {
+        len = packed_length(pattern);
+        if (len > max_length || len >= HAMILTON_MIN_LENGTH) {
+            break;
+        }
+
+        /* only the changed suffix of the line needs to be rewritten */
+        for (; prefix_length < len; prefix_length++) {
+            line[prefix_length] = (char)('0' + PACKED_DOT(pattern,
+                                                          prefix_length));
+        }
+        line[len] = '\n';
+
+        if (pattern_filter_match(filter, pattern)) {
+            fwrite(line, 1, len + 1, output_file);
+        }
+        pattern = next_pattern(table, pattern, &prefix_length);
+    }
+
+    output.output_file = output_file;
+    output.filter = filter;
+    len = filter->min_length > HAMILTON_MIN_LENGTH ? filter->min_length :
+          HAMILTON_MIN_LENGTH;
+    for (; len <= max_length; len++) {
+        build_hamilton_table(table, len, complete);
+        enumerate_hamilton(complete, buffer, write_packed_patterns, &output);
+    }
+
+    free(buffer);
+    free(complete);
+    free(table);
+
+    return;
+}
+
+/*
+ * Walk the patterns of a transition matrix once, counting, writing and
+ * collecting statistics as requested. Canonical and sorted output need a
+ * different order, so they are written separately.
+ *
+ * \param block_matrix the transition matrix to use
+ * \param options output order, filter, hash and threads to use
+ * \param output_file file to write to, NULL for no output
+ * \param pattern_count array to store the count for each length of
+ *        patterns, NULL if not needed
+ * \param scores score distribution to fill, NULL if not needed
+ * \param features dot statistics to fill, NULL if not needed
+ */
+void pattern_pass(int block_matrix[][10],
+                  const struct output_options *options,
+                  FILE* const output_file, int pattern_count[],
+                  struct score_histogram *scores,
+                  struct feature_histogram *features)
+{
+    struct transition_table *table;
+    struct visitor_pipeline pipeline;
+    struct pattern_counter counter;
+    struct pattern_writer writer;
+    struct threaded_writer threaded_writer;
+    struct bucket_writer bucket_writer;
+    struct dump_writer dump_writer;
+    struct suffix_cache *blocks = NULL;
+    struct scratch_arena *arena = scratch_arena(0);
+    int i;
+
+    if (output_file != NULL) {
+        if (options->canonical > 0) {
+            write_canonical_patterns(block_matrix, options, output_file);
+        } else if (options->sort_order.key_count > 0) {
+            write_sorted_patterns(block_matrix, options, output_file);
+        }
+    }
+
+    /* scratch memory is reused by the next query */
+    table = arena_alloc(arena, sizeof(struct transition_table));
+    if (table == NULL) {
+        fprintf(stderr, "Not enough memory for the transition table!\n");
+        arena_reset(arena);
+        return;
+    }
+    build_transition_table(block_matrix, table);
+
+    /* the cached blocks replace the pattern writer if they fit in memory */
+    if (output_file != NULL && options->canonical == 0 &&
+        options->sort_order.key_count == 0 && options->block_budget > 0 &&
+        options->hash == NULL && pattern_filter_empty(&options->filter))
+    {
+        blocks = create_suffix_cache(table, options->block_budget);
+        if (blocks == NULL) {
+            fprintf(stderr, "Not enough memory for the subtree blocks, "
+                    "writing the patterns one by one\n");
+        }
+    }
+
+    init_visitor_pipeline(&pipeline);
+    pipeline.hash = options->hash;
+    pipeline.salt = (const unsigned char *)options->salt;
+    pipeline.salt_len = strlen(options->salt);
+
+    if (pattern_count != NULL) {
+        add_pattern_counter(&pipeline, &counter);
+    }
+    if (output_file != NULL && options->canonical == 0 &&
+        options->sort_order.key_count == 0 && blocks == NULL)
+    {
+        writer.output_file = output_file;
+        writer.filter = &options->filter;
+        threaded_writer.output_file = output_file;
+        threaded_writer.filter = &options->filter;
+
+        /* format and write on their own threads if threads are allowed */
+        if (options->thread_count < 2 ||
+            add_threaded_writer(&pipeline, &threaded_writer) < 0)
+        {
+            add_pattern_writer(&pipeline, &writer);
+        }
+    }
+    if (options->bucket_directory != NULL) {
+        bucket_writer.directory = options->bucket_directory;
+        bucket_writer.filter = &options->filter;
+        if (add_bucket_writer(&pipeline, &bucket_writer) < 0) {
+            fprintf(stderr, "Could not create \"%s\" output directory\n",
+                    options->bucket_directory);
+        }
+    }
+    if (options->dump_file != NULL) {
+        dump_writer.output_file = options->dump_file;
+        dump_writer.filter = &options->filter;
+        if (add_dump_writer(&pipeline, &dump_writer) < 0) {
+            fprintf(stderr, "Could not write the dump file\n");
+        }
+    }
+    if (scores != NULL) {
+        scores->filter = &options->filter;
+        add_score_histogram(&pipeline, scores);
+    }
+    if (features != NULL) {
+        features->filter = &options->filter;
+        add_feature_histogram(&pipeline, features);
+    }
+
+    if (blocks != NULL) {
+        write_suffix_blocks(blocks, output_file);
+        free_suffix_cache(blocks);
+    }
+
+    if (pipeline.count > 0 &&
+        run_visitor_pipeline(&pipeline, table, arena) < 0)
+    {
+        fprintf(stderr, "Not enough memory for the pattern batches!\n");
+        arena_reset(arena);
+        return;
+    }
+    arena_reset(arena);
+
+    if (options->bucket_directory != NULL && bucket_writer.errors > 0) {
+        fprintf(stderr, "Could not write %d files in \"%s\"\n",
+                bucket_writer.errors, options->bucket_directory);
+    }
+
+    if (options->dump_file != NULL && dump_writer.errors > 0) {
+        fprintf(stderr, "Could not write the dump file\n");
+    }
+
+    if (pattern_count != NULL) {
+        for (i = 0; i < MAX_POINTS; i++) {
+            pattern_count[i] = counter.pattern_count[i];
+        }
+    }
+
+    return;
+}
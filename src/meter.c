@@ -0,0 +1,162 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Incremental strength meter for patterns being drawn.
+ *
+ * A lock setup screen wants new feedback on every dot: the score so far, how
+ * many longer patterns start with the dots drawn and the best score any of
+ * them reaches. The step score only depends on the last two dots and the
+ * pattern counts of every (used dot set, last dot) state are in the rank
+ * table, so the only missing piece is the best score below a state. That is
+ * a backward DP over the used dot sets, computed once, after which every
+ * update and query is a table lookup.
+ */
+
+#include <string.h>
+
+#include "meter.h"
+#include "score.h"
+
+/*
+ * Precompute the step scores and the best reachable scores
+ *
+ * \param ranks rank table of the transition matrix, must outlive the table
+ * \param table table to fill
+ */
+void build_meter_table(const struct rank_table *ranks,
+                       struct meter_table *table)
+{
+    int mask, prev, last, next;
+
+    table->ranks = ranks;
+
+    for (prev = 0; prev <= MAX_POINTS; prev++) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            for (next = 0; next <= MAX_POINTS; next++) {
+                /* dots of a pattern are distinct */
+                if (next == 0 || next == last ||
+                    (prev > 0 && prev == last))
+                {
+                    table->step[prev][last][next] = 0;
+                    continue;
+                }
+                table->step[prev][last][next] =
+                    (uint8_t)score_step(prev, last, next);
+            }
+        }
+    }
+
+    /* adding a dot gives a larger mask, so going down every state comes
+     * after all of its children */
+    memset(table->best, 0, sizeof(table->best));
+    for (mask = MASK_COUNT - 1; mask >= 0; mask--) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t moves = ranks->transitions.next[mask][last];
+
+            if ((last == 0) != (mask == 0) ||
+                (last > 0 && (mask & DOT_BIT(last)) == 0))
+            {
+                continue;
+            }
+
+            for (prev = 0; prev <= MAX_POINTS; prev++) {
+                uint16_t candidates;
+                int best = 0;
+
+                for (candidates = moves; candidates != 0;
+                     candidates &= candidates - 1)
+                {
+                    int gain;
+
+                    next = __builtin_ctz(candidates) + 1;
+                    gain = table->step[prev][last][next] +
+                        table->best[mask | DOT_BIT(next)][last][next];
+                    if (gain > best) {
+                        best = gain;
+                    }
+                }
+                table->best[mask][prev][last] = (uint8_t)best;
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ * Start a new pattern
+ *
+ * \param meter meter to reset
+ * \param table meter table of the transition matrix
+ */
+void meter_reset(struct strength_meter *meter,
+                 const struct meter_table *table)
+{
+    meter->table = table;
+    meter->mask = 0;
+    meter->prev = 0;
+    meter->last = 0;
+    meter->length = 0;
+    meter->score = 0;
+
+    return;
+}
+
+/*
+ * Add a dot to the pattern
+ *
+ * \param meter meter of the pattern
+ * \param dot dot to add (1-9)
+ * \return returns 0 on success, -1 if the dot can not be added
+ */
+int meter_add(struct strength_meter *meter, const int dot)
+{
+    if (dot < 1 || dot > MAX_POINTS ||
+        (meter_next_dots(meter) & DOT_BIT(dot)) == 0)
+    {
+        return -1;
+    }
+
+    meter->score += meter->table->step[meter->prev][meter->last][dot];
+    meter->mask |= DOT_BIT(dot);
+    meter->prev = meter->last;
+    meter->last = dot;
+    meter->length++;
+
+    return 0;
+}
+
+/*
+ * Dots which can be added next
+ *
+ * \return set of dots, bit DOT_BIT(dot) for every dot
+ */
+unsigned int meter_next_dots(const struct strength_meter *meter)
+{
+    return meter->table->ranks->transitions.next[meter->mask][meter->last];
+}
+
+/*
+ * Number of longer patterns starting with the dots drawn
+ */
+uint32_t meter_completions(const struct strength_meter *meter)
+{
+    uint32_t count = meter->table->ranks->suffix[meter->mask][meter->last];
+
+    /* the count of a state includes its own pattern, except for the root */
+    return meter->length > 0 ? count - 1 : count;
+}
+
+/*
+ * Best score of the pattern drawn or any longer one starting with it
+ */
+int meter_best_score(const struct strength_meter *meter)
+{
+    return meter->score +
+        meter->table->best[meter->mask][meter->prev][meter->last];
+}
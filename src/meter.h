@@ -0,0 +1,46 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Incremental strength meter for patterns being drawn.
+ */
+
+#ifndef AUPATTERNS_METER_H
+#define AUPATTERNS_METER_H
+
+#include "rank.h"
+
+/*
+ * Per state tables of the meter: the score of every step and the best score
+ * still reachable from every (used dot set, dot before last, last dot)
+ */
+struct meter_table {
+    const struct rank_table *ranks;
+    uint8_t step[MAX_POINTS + 1][MAX_POINTS + 1][MAX_POINTS + 1];
+    uint8_t best[MASK_COUNT][MAX_POINTS + 1][MAX_POINTS + 1];
+};
+
+/* A pattern being drawn */
+struct strength_meter {
+    const struct meter_table *table;
+    unsigned int mask;
+    int prev;
+    int last;
+    int length;
+    int score;
+};
+
+void build_meter_table(const struct rank_table *ranks,
+                       struct meter_table *table);
+void meter_reset(struct strength_meter *meter,
+                 const struct meter_table *table);
+int meter_add(struct strength_meter *meter, const int dot);
+unsigned int meter_next_dots(const struct strength_meter *meter);
+uint32_t meter_completions(const struct strength_meter *meter);
+int meter_best_score(const struct strength_meter *meter);
+
+#endif
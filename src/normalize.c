@@ -0,0 +1,256 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Normalization of intended dot sequences to drawable patterns.
+ *
+ * Telemetry records the dots a user aimed at (eg.: 1397), while the device
+ * connects every unused dot a line passes over (giving 123 ... 5 ... 7 and so
+ * on). What gets connected depends only on the used dot set, the last dot
+ * and the intended dot, so the result of every move is precomputed into a
+ * table and normalizing a sequence is one lookup per dot. Streams are read
+ * and written in large buffers, one sequence per line; sequences which can
+ * not be drawn (repeated dots, disabled moves) are echoed back prefixed
+ * with '!'.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "normalize.h"
+#include "probes.h"
+
+/*
+ * Connect a dot, connecting the unused dots on the way first
+ *
+ * \return returns 0 on success, -1 if the move is not possible
+ */
+static int connect_dot(int block_matrix[][10], unsigned int *mask,
+                       const int from, const int to, uint64_t *dots,
+                       int *count, const int depth)
+{
+    int blocker = block_matrix[from][to];
+
+    if ((*mask & DOT_BIT(to)) || blocker < 0 || depth > MAX_POINTS) {
+        return -1;
+    }
+
+    if (blocker > 0 && (*mask & DOT_BIT(blocker)) == 0) {
+        if (connect_dot(block_matrix, mask, from, blocker, dots, count,
+                        depth + 1) < 0)
+        {
+            return -1;
+        }
+        return connect_dot(block_matrix, mask, blocker, to, dots, count,
+                           depth + 1);
+    }
+
+    *dots |= (uint64_t)to << (4 * *count);
+    (*count)++;
+    *mask |= DOT_BIT(to);
+
+    return 0;
+}
+
+/*
+ * Precompute the connected dots of every move of every state
+ *
+ * \param block_matrix transition matrix to use
+ * \param table table to fill
+ */
+void build_normalize_table(int block_matrix[][10],
+                           struct normalize_table *table)
+{
+    unsigned int mask;
+    int last, next;
+
+    memset(table, 0, sizeof(struct normalize_table));
+
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            /* the root is the only state without a last dot */
+            if ((last == 0) != (mask == 0) ||
+                (last > 0 && (mask & DOT_BIT(last)) == 0))
+            {
+                continue;
+            }
+
+            for (next = 1; next <= MAX_POINTS; next++) {
+                unsigned int used = mask;
+                uint64_t dots = 0;
+                int count = 0;
+
+                if (connect_dot(block_matrix, &used, last, next, &dots,
+                                &count, 0) < 0)
+                {
+                    continue;
+                }
+                table->step[mask][last][next] = dots |
+                    (uint64_t)count << NORMALIZE_COUNT_SHIFT |
+                    (uint64_t)(used & ~mask) << NORMALIZE_MASK_SHIFT;
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ * Normalize an intended dot sequence
+ *
+ * \param table normalize table of the transition matrix
+ * \param str intended dots (eg.: 1397), not terminated
+ * \param len length of the string
+ * \param pattern the pattern actually drawn
+ * \return returns 0 on success, -1 if the sequence can not be drawn
+ */
+int normalize_dots(const struct normalize_table *table, const char *str,
+                   const size_t len, packed_pattern_t *pattern)
+{
+    packed_pattern_t p = 0;
+    unsigned int mask = 0;
+    int last = 0;
+    int count = 0;
+    size_t i;
+
+    if (len == 0 || len > MAX_POINTS) {
+        return -1;
+    }
+
+    for (i = 0; i < len; i++) {
+        unsigned int next = (unsigned int)(str[i] - '0');
+        uint64_t step;
+
+        if (next - 1 >= MAX_POINTS) {
+            return -1;
+        }
+        step = table->step[mask][last][next];
+        if (step == 0) {
+            return -1;
+        }
+
+        p |= (step & NORMALIZE_DOTS_MASK) << (4 * count);
+        count += (int)(step >> NORMALIZE_COUNT_SHIFT) & 0xf;
+        mask |= (unsigned int)(step >> NORMALIZE_MASK_SHIFT);
+        last = (int)next;
+    }
+
+    *pattern = p;
+    return 0;
+}
+
+/*
+ * Normalize one line into the output buffer
+ *
+ * \return number of bytes written
+ */
+static size_t normalize_line(const struct normalize_table *table,
+                             const char *line, size_t len, char *out,
+                             struct normalize_stats *stats)
+{
+    packed_pattern_t pattern;
+    size_t written;
+
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    stats->lines++;
+
+    if (normalize_dots(table, line, len, &pattern) < 0) {
+        stats->rejected++;
+        out[0] = '!';
+        memcpy(out + 1, line, len);
+        out[len + 1] = '\n';
+        return len + 2;
+    }
+
+    written = (size_t)packed_to_string(pattern, out);
+    if (written != len) {
+        stats->changed++;
+    }
+    out[written] = '\n';
+
+    return written + 1;
+}
+
+/*
+ * Normalize a stream of intended dot sequences, one per line
+ *
+ * \param table normalize table of the transition matrix
+ * \param input stream to read
+ * \param output stream to write the patterns (or the rejected lines) to
+ * \param stats totals of the stream
+ * \return returns 0 on success, -1 on read error or out of memory
+ */
+int normalize_stream(const struct normalize_table *table, FILE *input,
+                     FILE *output, struct normalize_stats *stats)
+{
+    /* a line is at most a whole input buffer, plus the marker and newline */
+    const size_t out_size = 2 * NORMALIZE_BUFFER_SIZE;
+    char *in, *out;
+    size_t fill = 0;
+    size_t out_fill = 0;
+    int r = 0;
+
+    memset(stats, 0, sizeof(struct normalize_stats));
+
+    in = malloc(NORMALIZE_BUFFER_SIZE);
+    out = malloc(out_size);
+    if (in == NULL || out == NULL) {
+        free(in);
+        free(out);
+        return -1;
+    }
+
+    for (;;) {
+        size_t wanted = NORMALIZE_BUFFER_SIZE - fill;
+        size_t got = fread(in + fill, 1, wanted, input);
+        int eof = got < wanted;
+        size_t start = 0;
+
+        fill += got;
+        while (start < fill) {
+            const char *line = in + start;
+            const char *newline = memchr(line, '\n', fill - start);
+            size_t len;
+
+            if (newline != NULL) {
+                len = (size_t)(newline - line);
+                start += len + 1;
+            } else if (!eof && start > 0) {
+                /* the rest of the line is in the next read */
+                break;
+            } else {
+                /* last line without newline, or longer than the buffer */
+                len = fill - start;
+                start = fill;
+            }
+
+            if (out_fill + len + MAX_POINTS + 2 > out_size) {
+                fwrite(out, 1, out_fill, output);
+                out_fill = 0;
+            }
+            out_fill += normalize_line(table, line, len, out + out_fill,
+                                       stats);
+        }
+        AUP_PROBE2(normalize_buffer, stats->lines, stats->rejected);
+
+        memmove(in, in + start, fill - start);
+        fill -= start;
+
+        if (eof) {
+            r = ferror(input) ? -1 : 0;
+            break;
+        }
+    }
+
+    fwrite(out, 1, out_fill, output);
+
+    free(in);
+    free(out);
+    return r;
+}
@@ -0,0 +1,53 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Normalization of intended dot sequences to drawable patterns.
+ */
+
+#ifndef AUPATTERNS_NORMALIZE_H
+#define AUPATTERNS_NORMALIZE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "pattern.h"
+
+/* Size of the input buffer of the stream normalizer, longer lines are
+ * split and rejected */
+#define NORMALIZE_BUFFER_SIZE (1 << 16)
+
+/*
+ * Dots actually connected when moving from the last dot towards an intended
+ * dot, for every (used dot set, last dot) state. An entry holds the packed
+ * dots (auto-connected ones first, the intended one last), their number at
+ * NORMALIZE_COUNT_SHIFT and the dots they add to the used set at
+ * NORMALIZE_MASK_SHIFT. 0 means the move is not possible.
+ */
+struct normalize_table {
+    uint64_t step[MASK_COUNT][MAX_POINTS + 1][MAX_POINTS + 1];
+};
+
+#define NORMALIZE_DOTS_MASK 0xfffffffffULL
+#define NORMALIZE_COUNT_SHIFT 40
+#define NORMALIZE_MASK_SHIFT 48
+
+/* Totals of a normalized stream */
+struct normalize_stats {
+    unsigned long lines;
+    unsigned long changed;
+    unsigned long rejected;
+};
+
+void build_normalize_table(int block_matrix[][10],
+                           struct normalize_table *table);
+int normalize_dots(const struct normalize_table *table, const char *str,
+                   const size_t len, packed_pattern_t *pattern);
+int normalize_stream(const struct normalize_table *table, FILE *input,
+                     FILE *output, struct normalize_stats *stats);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Canonical (length, then lexicographic) pattern order.
+ *
+ * Patterns are stepped through one by one with a successor function, nothing
+ * is materialized or sorted. The successor of a pattern keeps the longest
+ * possible prefix: the last dot that can be raised is raised to the smallest
+ * larger dot that still allows a pattern of the same length, and the rest is
+ * filled with the smallest possible completion. Consecutive patterns thus
+ * share as long a prefix as the order allows.
+ */
+
+#include "order.h"
+
+/*
+ * Fill the transitions and the possible extension lengths of every state
+ *
+ * \param block_matrix transition matrix to use
+ * \param table table to fill
+ */
+void build_order_table(int block_matrix[][10], struct order_table *table)
+{
+    int mask, last, next;
+
+    build_transition_table(block_matrix, &table->transitions);
+
+    /* every successor state has a bigger mask, so go downwards */
+    for (mask = MASK_COUNT - 1; mask >= 0; mask--) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t candidates = table->transitions.next[mask][last];
+            uint16_t extend = 1;
+
+            for (next = 1; next <= MAX_POINTS; next++) {
+                if (candidates & DOT_BIT(next)) {
+                    extend |= table->extend[mask | DOT_BIT(next)][next] << 1;
+                }
+            }
+            table->extend[mask][last] = extend;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Smallest dot that can follow a state and still leave room for exactly
+ * remaining more dots
+ *
+ * \return dot id, 0 if there is none
+ */
+static int smallest_next(const struct order_table *table,
+                         const unsigned int mask, uint16_t candidates,
+                         const int remaining)
+{
+    while (candidates != 0) {
+        int next = __builtin_ctz(candidates) + 1;
+
+        if (table->extend[mask | DOT_BIT(next)][next] & (1u << remaining)) {
+            return next;
+        }
+        candidates &= candidates - 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Extend a prefix with the smallest completion to a given length
+ *
+ * \return completed pattern, 0 if the prefix cannot be completed
+ */
+static packed_pattern_t complete_pattern(const struct order_table *table,
+                                         packed_pattern_t pattern,
+                                         unsigned int mask, int last,
+                                         int depth, const int length)
+{
+    while (depth < length) {
+        int next = smallest_next(table, mask,
+                                 table->transitions.next[mask][last],
+                                 length - depth - 1);
+
+        if (next == 0) {
+            return 0;
+        }
+        pattern |= (packed_pattern_t)next << (4 * depth);
+        mask |= DOT_BIT(next);
+        last = next;
+        depth++;
+    }
+
+    return pattern;
+}
+
+/*
+ * First pattern of a given length or, if there is none, of the next length
+ * that has patterns
+ *
+ * \param table order table of the transition matrix
+ * \param length length of the pattern (1-9)
+ * \return packed pattern, 0 if there are no patterns that long
+ */
+packed_pattern_t first_pattern(const struct order_table *table,
+                               const int length)
+{
+    packed_pattern_t pattern = 0;
+    int len;
+
+    for (len = length; len <= MAX_POINTS && pattern == 0; len++) {
+        pattern = complete_pattern(table, 0, 0, 0, 0, len);
+    }
+
+    return pattern;
+}
+
+/*
+ * Pattern following a given pattern in length, then lexicographic order
+ *
+ * \param table order table of the transition matrix
+ * \param pattern current valid pattern
+ * \param prefix_length set to the number of leading dots shared with the
+ *        current pattern
+ * \return next packed pattern, 0 if the current one was the last
+ */
+packed_pattern_t next_pattern(const struct order_table *table,
+                              const packed_pattern_t pattern,
+                              int *prefix_length)
+{
+    unsigned int masks[MAX_POINTS + 1];
+    int length = packed_length(pattern);
+    int i;
+
+    masks[0] = 0;
+    for (i = 0; i < length; i++) {
+        masks[i + 1] = masks[i] | DOT_BIT(PACKED_DOT(pattern, i));
+    }
+
+    /* raise the last dot that can be raised */
+    for (i = length - 1; i >= 0; i--) {
+        int last = (i > 0) ? PACKED_DOT(pattern, i - 1) : 0;
+        int current = PACKED_DOT(pattern, i);
+        uint16_t larger = table->transitions.next[masks[i]][last] &
+                          (uint16_t)~(DOT_BIT(current + 1) - 1);
+        int next = smallest_next(table, masks[i], larger,
+                                 length - i - 1);
+
+        if (next != 0) {
+            packed_pattern_t prefix = pattern &
+                (((packed_pattern_t)1 << (4 * i)) - 1);
+
+            *prefix_length = i;
+            return complete_pattern(table,
+                                    prefix | (packed_pattern_t)next << (4 * i),
+                                    masks[i] | DOT_BIT(next), next, i + 1,
+                                    length);
+        }
+    }
+
+    *prefix_length = 0;
+    if (length >= MAX_POINTS) {
+        return 0;
+    }
+
+    return first_pattern(table, length + 1);
+}
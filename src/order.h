@@ -0,0 +1,34 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Canonical (length, then lexicographic) pattern order.
+ */
+
+#ifndef AUPATTERNS_ORDER_H
+#define AUPATTERNS_ORDER_H
+
+#include "pattern.h"
+
+/*
+ * Transitions and, for every (used dot set, last dot) state, the set of
+ * lengths the pattern of the state can still be extended by: bit r is set if
+ * exactly r more dots can be added.
+ */
+struct order_table {
+    struct transition_table transitions;
+    uint16_t extend[MASK_COUNT][MAX_POINTS + 1];
+};
+
+void build_order_table(int block_matrix[][10], struct order_table *table);
+packed_pattern_t first_pattern(const struct order_table *table,
+                               const int length);
+packed_pattern_t next_pattern(const struct order_table *table,
+                              const packed_pattern_t pattern,
+                              int *prefix_length);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Minimal thread fan-out helper for the parallel enumerators.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+/* Arguments of one worker thread */
+struct worker_args {
+    parallel_fn fn;
+    void *ctx;
+    int thread_index;
+};
+
+/*
+ * Thread entry point, forwards to the worker function
+ */
+static void *worker_main(void *arg)
+{
+    struct worker_args *args = arg;
+
+    args->fn(args->ctx, args->thread_index);
+
+    return NULL;
+}
+
+/*
+ * Number of threads to use when the user did not specify it
+ *
+ * \return number of online processors, clamped to 1..MAX_THREADS
+ */
+int default_thread_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count < 1) {
+        return 1;
+    }
+    if (count > MAX_THREADS) {
+        return MAX_THREADS;
+    }
+
+    return (int)count;
+}
+
+/*
+ * Run a worker function on several threads and wait for all of them. The
+ * calling thread runs worker 0 itself, and also every worker for which no
+ * thread could be created, so each thread index is always run exactly once.
+ *
+ * \param thread_count number of workers to run (1..MAX_THREADS)
+ * \param fn worker function
+ * \param ctx context passed to every worker
+ * \return number of workers that were run
+ */
+int run_parallel(const int thread_count, parallel_fn fn, void *ctx)
+{
+    pthread_t threads[MAX_THREADS];
+    struct worker_args args[MAX_THREADS];
+    int started[MAX_THREADS];
+    int count = thread_count;
+    int i;
+
+    if (count < 1) {
+        count = 1;
+    } else if (count > MAX_THREADS) {
+        count = MAX_THREADS;
+    }
+
+    for (i = 0; i < count; i++) {
+        args[i].fn = fn;
+        args[i].ctx = ctx;
+        args[i].thread_index = i;
+        started[i] = 0;
+    }
+
+    for (i = 1; i < count; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, worker_main,
+                                     &args[i]) == 0);
+    }
+
+    worker_main(&args[0]);
+
+    for (i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            worker_main(&args[i]);
+        }
+    }
+
+    return count;
+}
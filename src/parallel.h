@@ -0,0 +1,24 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Minimal thread fan-out helper for the parallel enumerators.
+ */
+
+#ifndef AUPATTERNS_PARALLEL_H
+#define AUPATTERNS_PARALLEL_H
+
+/* Maximum number of worker threads */
+#define MAX_THREADS 64
+
+/* Worker function, called once on every thread */
+typedef void (*parallel_fn)(void *ctx, const int thread_index);
+
+int default_thread_count(void);
+int run_parallel(const int thread_count, parallel_fn fn, void *ctx);
+
+#endif
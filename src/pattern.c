@@ -0,0 +1,523 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Packed pattern helpers and the (used dot set, last dot) transition table
+ * which the enumerators walk.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern.h"
+
+/* Matrix describing which transition is blocked by which node */
+int pattern_block_matrix[10][10] = {
+   /*0, 1, 2, 3, 4, 5, 6, 7, 8, 9 */
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 0 */
+    {0, 0, 0, 2, 0, 0, 0, 4, 0, 5}, /* 1 */
+    {0, 0, 0, 0, 0, 0, 0, 0, 5, 0}, /* 2 */
+    {0, 2, 0, 0, 0, 0, 0, 5, 0, 6}, /* 3 */
+    {0, 0, 0, 0, 0, 0, 5, 0, 0, 0}, /* 4 */
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 5 */
+    {0, 0, 0, 0, 5, 0, 0, 0, 0, 0}, /* 6 */
+    {0, 4, 0, 5, 0, 0, 0, 0, 0, 8}, /* 7 */
+    {0, 0, 5, 0, 0, 0, 0, 0, 0, 0}, /* 8 */
+    {0, 5, 0, 6, 0, 0, 0, 8, 0, 0}, /* 9 */
+};
+
+/*
+ * Decide whether a transition is legal given the set of used dots. A blocked
+ * transition is legal once its blocker node is used, disabled transitions
+ * (negative entries) are never legal.
+ *
+ * \param block_matrix transition matrix to use
+ * \param used_mask dots already used on the branch
+ * \param from last dot of the branch (0 for the root)
+ * \param to dot to move to
+ * \return returns 1 if legal transition, 0 if illegal
+ */
+int transition_allowed(int block_matrix[][10], const unsigned int used_mask,
+                       const int from, const int to)
+{
+    int blocker = block_matrix[from][to];
+
+    /* dots can be used only once */
+    if (used_mask & DOT_BIT(to)) {
+        return 0;
+    }
+
+    /* legal transition if there is no blocker */
+    if (blocker == 0) {
+        return 1;
+    }
+
+    /* illegal transition because it is disabled */
+    if (blocker < 0) {
+        return 0;
+    }
+
+    /* legal only if the blocker node is already used */
+    return (used_mask & DOT_BIT(blocker)) ? 1 : 0;
+}
+
+/*
+ * Precompute the legal next dots for every (used dot set, last dot) state
+ *
+ * \param block_matrix transition matrix to use
+ * \param table table to fill
+ */
+void build_transition_table(int block_matrix[][10],
+                            struct transition_table *table)
+{
+    unsigned int mask;
+    int last, next;
+
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t bits = 0;
+
+            /* the root state has no used dots, other states use last */
+            if ((last == 0 && mask == 0) ||
+                (last > 0 && (mask & DOT_BIT(last))))
+            {
+                for (next = 1; next <= MAX_POINTS; next++) {
+                    if (transition_allowed(block_matrix, mask, last, next)) {
+                        bits |= DOT_BIT(next);
+                    }
+                }
+            }
+            table->next[mask][last] = bits;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Visit a pattern and all of its extensions in depth first order. The prefix
+ * must be a legal pattern.
+ *
+ * \param table legal transitions to follow
+ * \param prefix pattern to start from (0 visits every pattern)
+ * \param max_length do not extend patterns beyond this length (0 for no limit)
+ * \param visit callback for every visited pattern
+ * \param ctx context passed to the callback
+ */
+void enumerate_from(const struct transition_table *table,
+                    const packed_pattern_t prefix, const int max_length,
+                    pattern_visit_fn visit, void *ctx)
+{
+    uint16_t candidates[MAX_POINTS + 1];
+    packed_pattern_t pattern = prefix;
+    unsigned int mask = packed_used_mask(prefix);
+    int base = packed_length(prefix);
+    int limit = (max_length > 0) ? max_length : MAX_POINTS;
+    int depth = base;
+
+    if (base > 0) {
+        visit(ctx, prefix, mask);
+    }
+    candidates[depth] = (depth < limit) ?
+        table->next[mask][base > 0 ? PACKED_DOT(prefix, base - 1) : 0] : 0;
+
+    for (;;) {
+        int next;
+
+        if (candidates[depth] == 0) {
+            /* branch for this node is done, so remove it */
+            if (depth == base) {
+                break;
+            }
+            depth--;
+            mask &= ~DOT_BIT(PACKED_DOT(pattern, depth));
+            pattern &= ~((packed_pattern_t)0xf << (4 * depth));
+            continue;
+        }
+
+        next = __builtin_ctz(candidates[depth]) + 1;
+        candidates[depth] &= candidates[depth] - 1;
+
+        pattern |= (packed_pattern_t)next << (4 * depth);
+        mask |= DOT_BIT(next);
+        depth++;
+        visit(ctx, pattern, mask);
+
+        candidates[depth] = (depth < limit) ? table->next[mask][next] : 0;
+    }
+
+    return;
+}
+
+/*
+ * Length of a packed pattern
+ *
+ * \param pattern packed pattern
+ * \return number of dots in the pattern
+ */
+int packed_length(const packed_pattern_t pattern)
+{
+    if (pattern == 0) {
+        return 0;
+    }
+
+    return (64 - __builtin_clzll(pattern) + 3) / 4;
+}
+
+/*
+ * Set of dots used by a packed pattern
+ *
+ * \param pattern packed pattern
+ * \return used dot mask
+ */
+unsigned int packed_used_mask(const packed_pattern_t pattern)
+{
+    unsigned int mask = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; p != 0; p >>= 4) {
+        mask |= DOT_BIT(p & 0xf);
+    }
+
+    return mask;
+}
+
+/*
+ * Format a dot set as its ascending dot ids
+ *
+ * \param mask used dot set
+ * \param buffer buffer of at least MAX_POINTS + 1 characters
+ */
+void mask_to_string(const unsigned int mask, char *buffer)
+{
+    int len = 0;
+    int dot;
+
+    for (dot = 1; dot <= MAX_POINTS; dot++) {
+        if (mask & DOT_BIT(dot)) {
+            buffer[len++] = (char)('0' + dot);
+        }
+    }
+    buffer[len] = '\0';
+
+    return;
+}
+
+/*
+ * Format a packed pattern as a string of dot ids
+ *
+ * \param pattern packed pattern
+ * \param buffer buffer of at least MAX_POINTS + 1 characters
+ * \return length of the string written
+ */
+int packed_to_string(const packed_pattern_t pattern, char *buffer)
+{
+    int len = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; p != 0; p >>= 4) {
+        buffer[len++] = (char)('0' + (p & 0xf));
+    }
+    buffer[len] = '\0';
+
+    return len;
+}
+
+/*
+ * Parse a string of dot ids into a packed pattern. Only the syntax is checked,
+ * not whether the pattern can be drawn.
+ *
+ * \param str pattern string (eg.: 14789)
+ * \param pattern the parsed pattern
+ * \return returns 0 on success, -1 if the string is not a pattern
+ */
+int string_to_packed(const char *str, packed_pattern_t *pattern)
+{
+    packed_pattern_t p = 0;
+    int i;
+
+    for (i = 0; str[i] != '\0'; i++) {
+        if (i >= MAX_POINTS || str[i] < '1' || str[i] > '0' + MAX_POINTS) {
+            return -1;
+        }
+        p |= (packed_pattern_t)(str[i] - '0') << (4 * i);
+    }
+
+    if (i == 0) {
+        return -1;
+    }
+
+    *pattern = p;
+    return 0;
+}
+
+/*
+ * Reset a filter to match every pattern
+ *
+ * \param filter filter to initialize
+ */
+void init_pattern_filter(struct pattern_filter *filter)
+{
+    filter->min_length = 0;
+    filter->max_length = 0;
+    filter->start = 0;
+    filter->end = 0;
+    filter->must_use = 0;
+    filter->must_avoid = 0;
+    filter->min_turns = -1;
+    filter->max_turns = -1;
+    filter->min_path = -1;
+    filter->max_path = -1;
+
+    return;
+}
+
+/*
+ * Parse a dot list into a dot mask
+ */
+static int parse_dot_list(const char *str, const char *end, unsigned int *mask)
+{
+    *mask = 0;
+
+    for (; str < end; str++) {
+        if (*str < '1' || *str > '0' + MAX_POINTS) {
+            return -1;
+        }
+        *mask |= DOT_BIT(*str - '0');
+    }
+
+    return 0;
+}
+
+/*
+ * Parse a filter specification. Terms are separated by commas:
+ * len=MIN[-MAX], start=DOT, end=DOT, has=DOTS, not=DOTS, turns=MIN[-MAX],
+ * path=MIN[-MAX] (drawn length in dot distances)
+ *
+ * \param spec filter specification (eg.: len=6-9,start=1,not=5)
+ * \param filter filter to fill, must be initialized
+ * \return returns 0 on success, -1 on syntax error
+ */
+int parse_pattern_filter(const char *spec, struct pattern_filter *filter)
+{
+    const char *term = spec;
+
+    while (*term != '\0') {
+        const char *end = strchr(term, ',');
+        const char *value = strchr(term, '=');
+        unsigned int mask;
+
+        if (end == NULL) {
+            end = term + strlen(term);
+        }
+        if (value == NULL || value >= end || value + 1 == end) {
+            return -1;
+        }
+        value++;
+
+        if (strncmp(term, "len=", 4) == 0) {
+            char *rest;
+
+            filter->min_length = (int)strtol(value, &rest, 10);
+            filter->max_length = filter->min_length;
+            if (*rest == '-') {
+                filter->max_length = (int)strtol(rest + 1, &rest, 10);
+            }
+            if (rest != end || filter->min_length < 1 ||
+                filter->max_length < filter->min_length ||
+                filter->max_length > MAX_POINTS)
+            {
+                return -1;
+            }
+        } else if (strncmp(term, "start=", 6) == 0 ||
+                   strncmp(term, "end=", 4) == 0)
+        {
+            if (end - value != 1 || *value < '1' ||
+                *value > '0' + MAX_POINTS)
+            {
+                return -1;
+            }
+            if (term[0] == 's') {
+                filter->start = *value - '0';
+            } else {
+                filter->end = *value - '0';
+            }
+        } else if (strncmp(term, "has=", 4) == 0) {
+            if (parse_dot_list(value, end, &mask) < 0) {
+                return -1;
+            }
+            filter->must_use |= mask;
+        } else if (strncmp(term, "not=", 4) == 0) {
+            if (parse_dot_list(value, end, &mask) < 0) {
+                return -1;
+            }
+            filter->must_avoid |= mask;
+        } else if (strncmp(term, "turns=", 6) == 0) {
+            char *rest;
+
+            filter->min_turns = (int)strtol(value, &rest, 10);
+            filter->max_turns = filter->min_turns;
+            if (*rest == '-') {
+                filter->max_turns = (int)strtol(rest + 1, &rest, 10);
+            }
+            if (rest != end || filter->min_turns < 0 ||
+                filter->max_turns < filter->min_turns)
+            {
+                return -1;
+            }
+        } else if (strncmp(term, "path=", 5) == 0) {
+            char *rest;
+
+            filter->min_path = strtod(value, &rest);
+            filter->max_path = filter->min_path;
+            if (*rest == '-') {
+                filter->max_path = strtod(rest + 1, &rest);
+            }
+            if (rest != end || !(filter->min_path >= 0) ||
+                !(filter->max_path >= filter->min_path))
+            {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+
+        term = (*end == ',') ? end + 1 : end;
+    }
+
+    return 0;
+}
+
+/*
+ * Check whether a filter matches every pattern
+ *
+ * \param filter filter to check
+ * \return returns 1 if nothing is filtered out, 0 otherwise
+ */
+int pattern_filter_empty(const struct pattern_filter *filter)
+{
+    return filter->min_length == 0 && filter->max_length == 0 &&
+           filter->start == 0 && filter->end == 0 &&
+           filter->must_use == 0 && filter->must_avoid == 0 &&
+           filter->min_turns < 0 && filter->min_path < 0;
+}
+
+/*
+ * Check whether a pattern passes a filter
+ *
+ * \param filter filter to apply
+ * \param pattern packed pattern
+ * \return returns 1 if the pattern matches, 0 otherwise
+ */
+int pattern_filter_match(const struct pattern_filter *filter,
+                         const packed_pattern_t pattern)
+{
+    int len = packed_length(pattern);
+    unsigned int used = packed_used_mask(pattern);
+
+    if ((filter->min_length > 0 && len < filter->min_length) ||
+        (filter->max_length > 0 && len > filter->max_length))
+    {
+        return 0;
+    }
+
+    if ((filter->start > 0 && PACKED_DOT(pattern, 0) != filter->start) ||
+        (filter->end > 0 && PACKED_DOT(pattern, len - 1) != filter->end))
+    {
+        return 0;
+    }
+
+    if (((used & filter->must_use) != filter->must_use) ||
+        (used & filter->must_avoid) != 0)
+    {
+        return 0;
+    }
+
+    if (filter->min_turns >= 0) {
+        int turns = pattern_turns(pattern);
+
+        if (turns < filter->min_turns || turns > filter->max_turns) {
+            return 0;
+        }
+    }
+    if (filter->min_path >= 0) {
+        double path = pattern_path_length(pattern);
+
+        if (path < filter->min_path || path > filter->max_path) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Number of changes of direction while drawing a pattern
+ *
+ * \param pattern packed pattern
+ * \return number of turns
+ */
+int pattern_turns(const packed_pattern_t pattern)
+{
+    int turns = 0;
+    int dx = 0, dy = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; (p >> 4) != 0; p >>= 4) {
+        int from = (int)(p & 0xf) - 1;
+        int to = (int)((p >> 4) & 0xf) - 1;
+        int nx = to % 3 - from % 3;
+        int ny = to / 3 - from / 3;
+
+        /* a turn unless parallel and pointing the same way */
+        if (p != pattern &&
+            (dx * ny != dy * nx || dx * nx + dy * ny <= 0))
+        {
+            turns++;
+        }
+        dx = nx;
+        dy = ny;
+    }
+
+    return turns;
+}
+
+/*
+ * Length of the line drawn for a pattern
+ *
+ * \param pattern packed pattern
+ * \return sum of the segment lengths, neighbouring dots are 1 apart
+ */
+double pattern_path_length(const packed_pattern_t pattern)
+{
+    /* segment length by squared length, only sums of two squares occur */
+    static const double segment[9] = {
+        0, 1, 1.4142135623730951, 0, 2, 2.2360679774997898, 0, 0,
+        2.8284271247461903
+    };
+    double length = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; (p >> 4) != 0; p >>= 4) {
+        int from = (int)(p & 0xf) - 1;
+        int to = (int)((p >> 4) & 0xf) - 1;
+        int dx = to % 3 - from % 3;
+        int dy = to / 3 - from / 3;
+
+        length += segment[dx * dx + dy * dy];
+    }
+
+    return length;
+}
+
+/*
+ * Number of dots in a dot mask
+ */
+int popcount_mask(unsigned int mask)
+{
+    return __builtin_popcount(mask);
+}
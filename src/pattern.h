@@ -0,0 +1,87 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Common pattern representation shared by the enumerators.
+ */
+
+#ifndef AUPATTERNS_PATTERN_H
+#define AUPATTERNS_PATTERN_H
+
+#include <stdint.h>
+
+/* Number of points in the pattern which
+ * (it is also the maximum length of a pattern) */
+#define MAX_POINTS 9
+
+/* Number of possible used dot sets */
+#define MASK_COUNT (1 << MAX_POINTS)
+
+/* Bit of a dot (1-9) in a used dot set */
+#define DOT_BIT(dot) (1u << ((dot) - 1))
+
+/*
+ * A pattern packed into 64 bits. Dot ids are stored as 4-bit digits starting
+ * from the lowest nibble, unused nibbles are 0. Since dot ids are never 0 the
+ * length of the pattern is implied by the highest non-zero nibble.
+ */
+typedef uint64_t packed_pattern_t;
+
+/* Get the dot at position i (0 based) of a packed pattern */
+#define PACKED_DOT(p, i) ((int)(((p) >> (4 * (i))) & 0xf))
+
+/* Legal next dots for every (used dot set, last dot) state */
+struct transition_table {
+    uint16_t next[MASK_COUNT][MAX_POINTS + 1];
+};
+
+/* Callback for every pattern visited by enumerate_from() */
+typedef void (*pattern_visit_fn)(void *ctx, const packed_pattern_t pattern,
+                                 const unsigned int used_mask);
+
+/*
+ * Filter for selecting a subset of patterns, 0 fields match anything except
+ * the turn and path length bounds, which are unset at -1
+ */
+struct pattern_filter {
+    int min_length;
+    int max_length;
+    int start;
+    int end;
+    unsigned int must_use;
+    unsigned int must_avoid;
+    int min_turns;
+    int max_turns;
+    double min_path;
+    double max_path;
+};
+
+/* Matrix describing which transition is blocked by which node */
+extern int pattern_block_matrix[10][10];
+
+int transition_allowed(int block_matrix[][10], const unsigned int used_mask,
+                       const int from, const int to);
+void build_transition_table(int block_matrix[][10],
+                            struct transition_table *table);
+void enumerate_from(const struct transition_table *table,
+                    const packed_pattern_t prefix, const int max_length,
+                    pattern_visit_fn visit, void *ctx);
+int packed_length(const packed_pattern_t pattern);
+unsigned int packed_used_mask(const packed_pattern_t pattern);
+void mask_to_string(const unsigned int mask, char *buffer);
+int packed_to_string(const packed_pattern_t pattern, char *buffer);
+int string_to_packed(const char *str, packed_pattern_t *pattern);
+void init_pattern_filter(struct pattern_filter *filter);
+int parse_pattern_filter(const char *spec, struct pattern_filter *filter);
+int pattern_filter_empty(const struct pattern_filter *filter);
+int pattern_filter_match(const struct pattern_filter *filter,
+                         const packed_pattern_t pattern);
+int pattern_turns(const packed_pattern_t pattern);
+double pattern_path_length(const packed_pattern_t pattern);
+int popcount_mask(unsigned int mask);
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern policies of forbidden and required sub-patterns.
+ *
+ * A policy bans patterns containing any of a list of contiguous dot
+ * sequences (eg.: the "L" 14789) and may require others. The sequences are
+ * compiled into an Aho-Corasick automaton which is run as a drawing rule:
+ * the rule state is the automaton state plus the set of required sequences
+ * seen so far. Together with the (used dots, last dot) state of the
+ * transitions this is the product the rule counter memoizes, so counting
+ * under a policy costs no more than counting under a turn rule, and listing
+ * skips every subtree without an allowed pattern.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "policy.h"
+
+/* Bits of the automaton state in the rule state */
+#define POLICY_STATE_BITS 8
+
+/*
+ * Rule step: feed the dot to the automaton
+ */
+static int policy_step(const struct drawing_rule *rule, const int state,
+                       const unsigned int mask, const int last, const int next)
+{
+    const struct subpattern_policy *policy = rule->data;
+    int node = state & (MAX_POLICY_STATES - 1);
+    int found = state >> POLICY_STATE_BITS;
+
+    (void)mask;
+    (void)last;
+
+    node = policy->next[node][next];
+    if (policy->forbidden[node]) {
+        return -1;
+    }
+    found |= policy->required[node];
+
+    return node | (found << POLICY_STATE_BITS);
+}
+
+/*
+ * Rule acceptance: every required sub-pattern was seen
+ */
+static int policy_accept(const struct drawing_rule *rule, const int state)
+{
+    const struct subpattern_policy *policy = rule->data;
+    int all = (1 << policy->required_count) - 1;
+
+    return ((state >> POLICY_STATE_BITS) & all) == all;
+}
+
+/*
+ * Add a sub-pattern to the trie of the automaton
+ *
+ * \return returns 0 on success, -1 if it is not a pattern or too long
+ */
+static int add_subpattern(struct subpattern_policy *policy, const char *str,
+                          const char *end, const int required)
+{
+    int node = 0;
+
+    if (end == str || end - str > MAX_POINTS) {
+        return -1;
+    }
+
+    for (; str < end; str++) {
+        int dot = *str - '0';
+
+        if (dot < 1 || dot > MAX_POINTS) {
+            return -1;
+        }
+        if (policy->next[node][dot] == 0) {
+            if (policy->state_count == MAX_POLICY_STATES) {
+                return -1;
+            }
+            policy->next[node][dot] = (uint8_t)policy->state_count++;
+        }
+        node = policy->next[node][dot];
+    }
+
+    if (required) {
+        policy->required[node] |= (uint8_t)(1 << policy->required_count++);
+    } else {
+        policy->forbidden[node] = 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Resolve the failure links breadth first, so that next[][] holds the
+ * transition of every state and every dot, and the matches of a state
+ * include the ones of its longest proper suffix
+ */
+static void link_automaton(struct subpattern_policy *policy)
+{
+    uint8_t fail[MAX_POLICY_STATES];
+    uint8_t queue[MAX_POLICY_STATES];
+    int head = 0, tail = 0;
+    int dot;
+
+    for (dot = 1; dot <= MAX_POINTS; dot++) {
+        int child = policy->next[0][dot];
+
+        if (child != 0) {
+            fail[child] = 0;
+            queue[tail++] = (uint8_t)child;
+        }
+    }
+
+    while (head < tail) {
+        int node = queue[head++];
+
+        for (dot = 1; dot <= MAX_POINTS; dot++) {
+            int child = policy->next[node][dot];
+
+            if (child == 0) {
+                policy->next[node][dot] = policy->next[fail[node]][dot];
+                continue;
+            }
+            fail[child] = policy->next[fail[node]][dot];
+            policy->forbidden[child] |= policy->forbidden[fail[child]];
+            policy->required[child] |= policy->required[fail[child]];
+            queue[tail++] = (uint8_t)child;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Parse a policy: a comma separated list of sub-patterns, the ones prefixed
+ * with + are required, the others forbidden
+ *
+ * \param spec policy specification (eg.: 14789,123,+5)
+ * \param policy policy to fill
+ * \return returns 0 on success, -1 on syntax error or too many sub-patterns
+ */
+int parse_subpattern_policy(const char *spec,
+                            struct subpattern_policy *policy)
+{
+    const char *item = spec;
+
+    memset(policy, 0, sizeof(struct subpattern_policy));
+    policy->state_count = 1;
+
+    while (*item != '\0') {
+        const char *end = strchr(item, ',');
+        int required = (*item == '+');
+
+        if (end == NULL) {
+            end = item + strlen(item);
+        }
+        if (required && policy->required_count == MAX_REQUIRED_SUBPATTERNS) {
+            return -1;
+        }
+        if (add_subpattern(policy, item + required, end, required) < 0) {
+            return -1;
+        }
+
+        item = (*end == ',') ? end + 1 : end;
+    }
+
+    link_automaton(policy);
+
+    return 0;
+}
+
+/*
+ * Set up a drawing rule enforcing a policy
+ *
+ * \param policy parsed policy, must outlive the rule
+ * \param rule rule to fill
+ */
+void init_policy_rule(const struct subpattern_policy *policy,
+                      struct drawing_rule *rule)
+{
+    rule->name = "policy";
+    rule->parameter = 0;
+    rule->initial_state = 0;
+    rule->step = policy_step;
+    rule->accept = policy_accept;
+    rule->data = policy;
+    memset(rule->allowed, 1, sizeof(rule->allowed));
+
+    return;
+}
@@ -0,0 +1,40 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern policies of forbidden and required sub-patterns.
+ */
+
+#ifndef AUPATTERNS_POLICY_H
+#define AUPATTERNS_POLICY_H
+
+#include "rules.h"
+
+/* Largest number of automaton states, the root included */
+#define MAX_POLICY_STATES 256
+
+/* Largest number of required sub-patterns */
+#define MAX_REQUIRED_SUBPATTERNS 8
+
+/*
+ * Aho-Corasick automaton of the sub-patterns of a policy with the failure
+ * links resolved, so every dot is a single table lookup
+ */
+struct subpattern_policy {
+    int state_count;
+    int required_count;
+    uint8_t next[MAX_POLICY_STATES][MAX_POINTS + 1];
+    uint8_t forbidden[MAX_POLICY_STATES];
+    uint8_t required[MAX_POLICY_STATES];
+};
+
+int parse_subpattern_policy(const char *spec,
+                            struct subpattern_policy *policy);
+void init_policy_rule(const struct subpattern_policy *policy,
+                      struct drawing_rule *rule);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Static user level tracepoints of the enumeration and output paths.
+ *
+ * With <sys/sdt.h> available (HAVE_SYS_SDT_H) every probe compiles to a
+ * single nop plus a note in the binary, which bpftrace and perf can attach
+ * to (eg.: bpftrace -e 'usdt:./aupatterns:aupatterns:shard_done
+ * { @[arg0] = arg1; }'). Without it the probes compile to nothing.
+ *
+ * Probes, all in the aupatterns provider:
+ *   enumerate_start(visitors), enumerate_end(visitors)
+ *   table_start(threads), table_end(patterns)
+ *   shard_done(shard, patterns)
+ *   rule_count_start(rule), rule_count_end(hits, misses)
+ *   memo_hit(key), memo_miss(key)
+ *   output_flush(bytes), bucket_flush(mask, bytes)
+ *   corpus_chunk_done(thread, lines)
+ *   sample_batch(walked, printed)
+ *   normalize_buffer(lines, rejected)
+ *   dump_round(first_block, blocks)
+ *   suffix_blocks(depth, bytes)
+ */
+
+#ifndef AUPATTERNS_PROBES_H
+#define AUPATTERNS_PROBES_H
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define AUP_PROBE1(name, a) DTRACE_PROBE1(aupatterns, name, a)
+#define AUP_PROBE2(name, a, b) DTRACE_PROBE2(aupatterns, name, a, b)
+
+#else
+
+#define AUP_PROBE1(name, a) do { } while (0)
+#define AUP_PROBE2(name, a, b) do { } while (0)
+
+#endif
+
+#endif
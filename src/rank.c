@@ -0,0 +1,176 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Validation, ranking and unranking of patterns.
+ *
+ * The rank of a pattern is its index in the depth first (pre-order) walk of
+ * the pattern tree with children in increasing dot order, the same order in
+ * which enumerate_from() visits the patterns. Ranks are computed from the
+ * number of patterns below every state, so no tree is needed.
+ */
+
+#include "rank.h"
+
+/*
+ * Fill the transitions and the per state pattern counts
+ *
+ * \param block_matrix transition matrix to use
+ * \param table table to fill
+ */
+void build_rank_table(int block_matrix[][10], struct rank_table *table)
+{
+    int mask, last, next;
+
+    build_transition_table(block_matrix, &table->transitions);
+
+    /* every successor state has a bigger mask, so go downwards */
+    for (mask = MASK_COUNT - 1; mask >= 0; mask--) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t candidates = table->transitions.next[mask][last];
+            uint32_t count = (mask != 0) ? 1 : 0;
+
+            if (mask != 0 && (last == 0 || (mask & DOT_BIT(last)) == 0)) {
+                table->suffix[mask][last] = 0;
+                continue;
+            }
+
+            for (next = 1; next <= MAX_POINTS; next++) {
+                if (candidates & DOT_BIT(next)) {
+                    count += table->suffix[mask | DOT_BIT(next)][next];
+                }
+            }
+            table->suffix[mask][last] = count;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Check whether a pattern can be drawn
+ *
+ * \param transitions legal transitions
+ * \param pattern packed pattern
+ * \return returns 1 if the pattern is valid, 0 otherwise
+ */
+int pattern_valid(const struct transition_table *transitions,
+                  const packed_pattern_t pattern)
+{
+    unsigned int mask = 0;
+    int last = 0;
+    packed_pattern_t p;
+
+    if (pattern == 0) {
+        return 0;
+    }
+
+    for (p = pattern; p != 0; p >>= 4) {
+        int next = (int)(p & 0xf);
+
+        if (next == 0 || next > MAX_POINTS ||
+            (transitions->next[mask][last] & DOT_BIT(next)) == 0)
+        {
+            return 0;
+        }
+        mask |= DOT_BIT(next);
+        last = next;
+    }
+
+    return 1;
+}
+
+/*
+ * Rank of a valid pattern
+ *
+ * \param table rank table of the transition matrix
+ * \param pattern valid packed pattern
+ * \return index of the pattern in depth first order
+ */
+uint32_t pattern_rank(const struct rank_table *table,
+                      const packed_pattern_t pattern)
+{
+    uint32_t rank = 0;
+    unsigned int mask = 0;
+    int last = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; p != 0; p >>= 4) {
+        int next = (int)(p & 0xf);
+        uint16_t before = table->transitions.next[mask][last] &
+                          (DOT_BIT(next) - 1);
+
+        /* skip the subtrees of the smaller siblings */
+        while (before != 0) {
+            int sibling = __builtin_ctz(before) + 1;
+
+            rank += table->suffix[mask | DOT_BIT(sibling)][sibling];
+            before &= before - 1;
+        }
+
+        /* skip the node itself if the pattern continues below it */
+        if ((p >> 4) != 0) {
+            rank++;
+        }
+        mask |= DOT_BIT(next);
+        last = next;
+    }
+
+    return rank;
+}
+
+/*
+ * Pattern of a given rank
+ *
+ * \param table rank table of the transition matrix
+ * \param rank rank of the pattern, must be smaller than suffix[0][0]
+ * \return packed pattern, 0 if the rank is out of range
+ */
+packed_pattern_t pattern_unrank(const struct rank_table *table, uint32_t rank)
+{
+    packed_pattern_t pattern = 0;
+    unsigned int mask = 0;
+    int last = 0;
+    int depth = 0;
+
+    if (rank >= table->suffix[0][0]) {
+        return 0;
+    }
+
+    for (;;) {
+        uint16_t candidates = table->transitions.next[mask][last];
+        int next = 0;
+
+        while (candidates != 0) {
+            uint32_t count;
+
+            next = __builtin_ctz(candidates) + 1;
+            count = table->suffix[mask | DOT_BIT(next)][next];
+            if (rank < count) {
+                break;
+            }
+            rank -= count;
+            candidates &= candidates - 1;
+        }
+
+        if (candidates == 0) {
+            return 0;
+        }
+
+        pattern |= (packed_pattern_t)next << (4 * depth);
+        depth++;
+        mask |= DOT_BIT(next);
+        last = next;
+
+        if (rank == 0) {
+            break;
+        }
+        rank--;
+    }
+
+    return pattern;
+}
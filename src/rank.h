@@ -0,0 +1,35 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Validation, ranking and unranking of patterns.
+ */
+
+#ifndef AUPATTERNS_RANK_H
+#define AUPATTERNS_RANK_H
+
+#include "pattern.h"
+
+/*
+ * Transitions and the number of patterns below every (used dot set, last dot)
+ * state. The count of a state includes the pattern of the state itself,
+ * except for the root state (0, 0), whose count is the number of patterns.
+ */
+struct rank_table {
+    struct transition_table transitions;
+    uint32_t suffix[MASK_COUNT][MAX_POINTS + 1];
+};
+
+void build_rank_table(int block_matrix[][10], struct rank_table *table);
+int pattern_valid(const struct transition_table *transitions,
+                  const packed_pattern_t pattern);
+uint32_t pattern_rank(const struct rank_table *table,
+                      const packed_pattern_t pattern);
+packed_pattern_t pattern_unrank(const struct rank_table *table,
+                                uint32_t rank);
+
+#endif
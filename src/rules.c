@@ -0,0 +1,466 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Memoized pattern counting under extra drawing rules.
+ *
+ * Some lock variants restrict the turns of a pattern, so whether a move is
+ * legal depends on more than the used dots and the last dot. As long as the
+ * rule can be written as a finite state machine, the number of completions
+ * of a pattern only depends on its (used dots, last dot, rule state)
+ * signature. The counts of every signature are memoized in an open
+ * addressing hash table, so counting never has to enumerate the patterns.
+ * The count state and the memo table are taken from the scratch arena of
+ * the caller, so repeated queries do not touch the heap.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "probes.h"
+#include "rules.h"
+
+/* Initial number of memo table slots, must be a power of two */
+#define MEMO_INITIAL_SIZE 4096
+
+/* Column and row of a dot on the 3x3 grid */
+#define DOT_X(dot) (((dot) - 1) % 3)
+#define DOT_Y(dot) (((dot) - 1) / 3)
+
+/* Memoized completions of a state signature, counts[r] has r more dots */
+struct memo_entry {
+    uint32_t key;
+    uint32_t counts[MAX_POINTS + 1];
+};
+
+/* Open addressing hash table with linear probing, key 0 marks empty slots */
+struct memo_table {
+    struct scratch_arena *arena;
+    struct memo_entry *entries;
+    size_t size;
+    size_t used;
+    struct rule_count_stats stats;
+};
+
+/* State of one count */
+struct rule_count {
+    struct transition_table transitions;
+    const struct drawing_rule *rule;
+    struct memo_table memo;
+    int failed;
+};
+
+/*
+ * Rule state of the turn rules: the dot before the last one
+ */
+static int turn_step(const struct drawing_rule *rule, const int state,
+                     const unsigned int mask, const int last, const int next)
+{
+    (void)mask;
+
+    if (rule->allowed[state][last][next] == 0) {
+        return -1;
+    }
+
+    return last;
+}
+
+/*
+ * No extra restriction, the rule state is always 0
+ */
+static int free_step(const struct drawing_rule *rule, const int state,
+                     const unsigned int mask, const int last, const int next)
+{
+    (void)rule;
+    (void)state;
+    (void)mask;
+    (void)last;
+    (void)next;
+
+    return 0;
+}
+
+/*
+ * Precompute which turns are within the allowed angle
+ */
+static void fill_turn_table(struct drawing_rule *rule, const int max_degrees)
+{
+    int prev, last, next;
+
+    for (prev = 0; prev <= MAX_POINTS; prev++) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            for (next = 1; next <= MAX_POINTS; next++) {
+                double ax, ay, bx, by, angle;
+
+                rule->allowed[prev][last][next] = 1;
+                if (prev == 0 || last == 0 || prev == last || last == next) {
+                    continue;
+                }
+
+                ax = DOT_X(last) - DOT_X(prev);
+                ay = DOT_Y(last) - DOT_Y(prev);
+                bx = DOT_X(next) - DOT_X(last);
+                by = DOT_Y(next) - DOT_Y(last);
+                angle = atan2(ax * by - ay * bx, ax * bx + ay * by);
+                angle = fabs(angle) * 180.0 / M_PI;
+
+                /* small tolerance for rounding of the exact angles */
+                if (angle > max_degrees + 1e-6) {
+                    rule->allowed[prev][last][next] = 0;
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ * Parse a rule specification: none, no-uturn or max-turn=DEGREES
+ *
+ * \param spec rule specification
+ * \param rule rule to fill
+ * \return returns 0 on success, -1 on unknown rule
+ */
+int parse_drawing_rule(const char *spec, struct drawing_rule *rule)
+{
+    rule->initial_state = 0;
+    rule->parameter = 0;
+    rule->accept = NULL;
+    rule->data = NULL;
+
+    if (strcmp(spec, "none") == 0) {
+        rule->name = "none";
+        rule->step = free_step;
+        fill_turn_table(rule, 180);
+        return 0;
+    }
+
+    if (strcmp(spec, "no-uturn") == 0) {
+        rule->name = "no-uturn";
+        rule->parameter = 179;
+    } else if (strncmp(spec, "max-turn=", 9) == 0) {
+        char *end;
+
+        rule->name = "max-turn";
+        rule->parameter = (int)strtol(spec + 9, &end, 10);
+        if (*end != '\0' || end == spec + 9 || rule->parameter < 0 ||
+            rule->parameter > 180)
+        {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    rule->step = turn_step;
+    fill_turn_table(rule, rule->parameter);
+
+    return 0;
+}
+
+/*
+ * Signature of a state, never 0 since a visited state has a last dot
+ */
+static uint32_t state_signature(const unsigned int mask, const int last,
+                                const int state)
+{
+    return (uint32_t)mask | ((uint32_t)last << MAX_POINTS) |
+           ((uint32_t)state << (MAX_POINTS + 4));
+}
+
+/*
+ * Find the slot of a key, either holding it or empty
+ */
+static struct memo_entry *memo_slot(struct memo_table *memo,
+                                    const uint32_t key)
+{
+    size_t i = (key * 2654435761u) & (memo->size - 1);
+
+    while (memo->entries[i].key != 0 && memo->entries[i].key != key) {
+        i = (i + 1) & (memo->size - 1);
+    }
+
+    return &memo->entries[i];
+}
+
+/*
+ * Double the memo table once it is more than half full. The old table stays
+ * in the arena until the caller resets it.
+ *
+ * \return returns 0 on success, -1 if out of memory
+ */
+static int memo_grow(struct memo_table *memo)
+{
+    struct memo_entry *old = memo->entries;
+    size_t old_size = memo->size;
+    size_t i;
+
+    memo->entries = arena_alloc(memo->arena,
+                                old_size * 2 * sizeof(struct memo_entry));
+    if (memo->entries == NULL) {
+        memo->entries = old;
+        return -1;
+    }
+    memset(memo->entries, 0, old_size * 2 * sizeof(struct memo_entry));
+    memo->size = old_size * 2;
+
+    for (i = 0; i < old_size; i++) {
+        if (old[i].key != 0) {
+            *memo_slot(memo, old[i].key) = old[i];
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Number of completions of a state by the number of added dots
+ */
+static const uint32_t *count_state(struct rule_count *count,
+                                   const unsigned int mask, const int last,
+                                   const int state)
+{
+    static const uint32_t none[MAX_POINTS + 1];
+    uint32_t counts[MAX_POINTS + 1];
+    uint32_t key = state_signature(mask, last, state);
+    struct memo_entry *entry;
+    uint16_t candidates;
+    int next, r;
+
+    entry = memo_slot(&count->memo, key);
+    if (entry->key == key) {
+        count->memo.stats.hits++;
+        AUP_PROBE1(memo_hit, key);
+        return entry->counts;
+    }
+    count->memo.stats.misses++;
+    AUP_PROBE1(memo_miss, key);
+
+    memset(counts, 0, sizeof(counts));
+    counts[0] = (count->rule->accept == NULL ||
+                 count->rule->accept(count->rule, state)) ? 1 : 0;
+
+    candidates = count->transitions.next[mask][last];
+    while (candidates != 0) {
+        const uint32_t *child;
+        int child_state;
+
+        next = __builtin_ctz(candidates) + 1;
+        candidates &= candidates - 1;
+
+        child_state = count->rule->step(count->rule, state, mask, last, next);
+        if (child_state < 0) {
+            continue;
+        }
+
+        child = count_state(count, mask | DOT_BIT(next), next, child_state);
+        for (r = 0; r < MAX_POINTS; r++) {
+            counts[r + 1] += child[r];
+        }
+    }
+
+    if (count->memo.used * 2 >= count->memo.size &&
+        memo_grow(&count->memo) < 0)
+    {
+        count->failed = 1;
+        return none;
+    }
+
+    /* the recursion may have moved entries, look the slot up again */
+    entry = memo_slot(&count->memo, key);
+    entry->key = key;
+    memcpy(entry->counts, counts, sizeof(counts));
+    count->memo.used++;
+    count->memo.stats.states = count->memo.used;
+
+    return entry->counts;
+}
+
+/*
+ * Set up the transitions and an empty memo table for a rule
+ *
+ * \return the count state, NULL if out of memory
+ */
+static struct rule_count *new_rule_count(int block_matrix[][10],
+                                         const struct drawing_rule *rule,
+                                         struct scratch_arena *arena)
+{
+    struct rule_count *count;
+
+    count = arena_alloc(arena, sizeof(struct rule_count));
+    if (count == NULL) {
+        return NULL;
+    }
+    count->memo.arena = arena;
+    count->memo.entries = arena_alloc(arena, MEMO_INITIAL_SIZE *
+                                      sizeof(struct memo_entry));
+    if (count->memo.entries == NULL) {
+        return NULL;
+    }
+    memset(count->memo.entries, 0,
+           MEMO_INITIAL_SIZE * sizeof(struct memo_entry));
+    count->memo.size = MEMO_INITIAL_SIZE;
+    count->memo.used = 0;
+    memset(&count->memo.stats, 0, sizeof(count->memo.stats));
+    count->rule = rule;
+    count->failed = 0;
+    build_transition_table(block_matrix, &count->transitions);
+
+    return count;
+}
+
+/*
+ * Count the patterns of every length under a drawing rule
+ *
+ * \param block_matrix transition matrix to use
+ * \param rule extra drawing rule
+ * \param pattern_count array to store the count for each length of patterns
+ * \param stats memo table statistics, may be NULL
+ * \param arena scratch arena to take the memo table from, reset by the
+ *        caller
+ * \return returns 0 on success, -1 if out of memory
+ */
+int count_with_rule(int block_matrix[][10], const struct drawing_rule *rule,
+                    int pattern_count[], struct rule_count_stats *stats,
+                    struct scratch_arena *arena)
+{
+    struct rule_count *count;
+    int first, r;
+
+    for (r = 0; r < MAX_POINTS; r++) {
+        pattern_count[r] = 0;
+    }
+
+    count = new_rule_count(block_matrix, rule, arena);
+    if (count == NULL) {
+        return -1;
+    }
+
+    AUP_PROBE1(rule_count_start, rule->name);
+    for (first = 1; first <= MAX_POINTS && count->failed == 0; first++) {
+        const uint32_t *counts;
+        int state;
+
+        if ((count->transitions.next[0][0] & DOT_BIT(first)) == 0) {
+            continue;
+        }
+        state = rule->step(rule, rule->initial_state, 0, 0, first);
+        if (state < 0) {
+            continue;
+        }
+        counts = count_state(count, DOT_BIT(first), first, state);
+        for (r = 0; r < MAX_POINTS; r++) {
+            pattern_count[r] += (int)counts[r];
+        }
+    }
+
+    AUP_PROBE2(rule_count_end, count->memo.stats.hits,
+               count->memo.stats.misses);
+
+    if (stats != NULL) {
+        *stats = count->memo.stats;
+    }
+
+    return count->failed ? -1 : 0;
+}
+
+/*
+ * Write the accepted patterns below a state, skipping every subtree the memo
+ * counts show to be empty
+ */
+static void list_state(struct rule_count *count,
+                       const struct pattern_filter *filter, FILE *output_file,
+                       const packed_pattern_t pattern, const int depth,
+                       const unsigned int mask, const int last,
+                       const int state)
+{
+    const struct drawing_rule *rule = count->rule;
+    uint16_t candidates = count->transitions.next[mask][last];
+    char line[MAX_POINTS + 2];
+    int len;
+
+    if ((rule->accept == NULL || rule->accept(rule, state)) &&
+        pattern_filter_match(filter, pattern))
+    {
+        len = packed_to_string(pattern, line);
+        line[len++] = '\n';
+        fwrite(line, 1, len, output_file);
+    }
+
+    if (filter->max_length > 0 && depth >= filter->max_length) {
+        return;
+    }
+
+    while (candidates != 0 && count->failed == 0) {
+        const uint32_t *counts;
+        uint32_t total = 0;
+        int next = __builtin_ctz(candidates) + 1;
+        int child_state, r;
+
+        candidates &= candidates - 1;
+
+        child_state = rule->step(rule, state, mask, last, next);
+        if (child_state < 0) {
+            continue;
+        }
+        counts = count_state(count, mask | DOT_BIT(next), next, child_state);
+        for (r = 0; r < MAX_POINTS; r++) {
+            total += counts[r];
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        list_state(count, filter, output_file,
+                   pattern | (packed_pattern_t)next << (4 * depth), depth + 1,
+                   mask | DOT_BIT(next), next, child_state);
+    }
+
+    return;
+}
+
+/*
+ * Write the patterns allowed by a drawing rule in depth first order
+ *
+ * \param block_matrix transition matrix to use
+ * \param rule extra drawing rule
+ * \param filter only patterns matching the filter are written
+ * \param output_file file to write to
+ * \param arena scratch arena to take the memo table from, reset by the
+ *        caller
+ * \return returns 0 on success, -1 if out of memory
+ */
+int list_with_rule(int block_matrix[][10], const struct drawing_rule *rule,
+                   const struct pattern_filter *filter, FILE *output_file,
+                   struct scratch_arena *arena)
+{
+    struct rule_count *count;
+    uint16_t candidates;
+
+    count = new_rule_count(block_matrix, rule, arena);
+    if (count == NULL) {
+        return -1;
+    }
+
+    /* the root has no dot, so it is never listed itself */
+    candidates = count->transitions.next[0][0];
+    while (candidates != 0 && count->failed == 0) {
+        int first = __builtin_ctz(candidates) + 1;
+        int state;
+
+        candidates &= candidates - 1;
+        state = rule->step(rule, rule->initial_state, 0, 0, first);
+        if (state >= 0) {
+            list_state(count, filter, output_file, (packed_pattern_t)first,
+                       1, DOT_BIT(first), first, state);
+        }
+    }
+
+    return count->failed ? -1 : 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Memoized pattern counting under extra drawing rules.
+ */
+
+#ifndef AUPATTERNS_RULES_H
+#define AUPATTERNS_RULES_H
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "pattern.h"
+
+/*
+ * An extra drawing rule on top of a transition matrix, expressed as a finite
+ * state machine. The rule state is a small number (below 1 << 16) carried
+ * along the pattern; together with the used dots and the last dot it forms
+ * the state signature counts are memoized by.
+ */
+struct drawing_rule {
+    const char *name;
+    int parameter;
+    int initial_state;
+    /* new rule state after moving from last to next (0 for the first
+     * dot), -1 if forbidden */
+    int (*step)(const struct drawing_rule *rule, const int state,
+                const unsigned int mask, const int last, const int next);
+    /* whether a pattern may end in a rule state, NULL if it always may */
+    int (*accept)(const struct drawing_rule *rule, const int state);
+    /* tables of rules defined elsewhere */
+    const void *data;
+    /* turns allowed by the turn rules, indexed [prev][last][next] */
+    unsigned char allowed[MAX_POINTS + 1][MAX_POINTS + 1][MAX_POINTS + 1];
+};
+
+/* Statistics of the memo table of the last count */
+struct rule_count_stats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long states;
+};
+
+int parse_drawing_rule(const char *spec, struct drawing_rule *rule);
+int count_with_rule(int block_matrix[][10], const struct drawing_rule *rule,
+                    int pattern_count[], struct rule_count_stats *stats,
+                    struct scratch_arena *arena);
+int list_with_rule(int block_matrix[][10], const struct drawing_rule *rule,
+                   const struct pattern_filter *filter, FILE *output_file,
+                   struct scratch_arena *arena);
+
+#endif
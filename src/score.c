@@ -0,0 +1,100 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Simple pattern complexity score. Every dot is worth 1, every segment is
+ * worth the number of rows and columns it crosses and every change of
+ * direction is worth 1 more. Longer patterns with long, knight-like and
+ * turning strokes score higher than short straight ones.
+ */
+
+#include <stdlib.h>
+
+#include "score.h"
+
+/* Column and row of a dot on the 3x3 grid */
+#define DOT_X(dot) (((dot) - 1) % 3)
+#define DOT_Y(dot) (((dot) - 1) / 3)
+
+/*
+ * Greatest common divisor of two small non-negative numbers
+ */
+static int gcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+/*
+ * Check whether two segments point in the same direction
+ */
+static int same_direction(const int a, const int b, const int c)
+{
+    int dx1 = DOT_X(b) - DOT_X(a);
+    int dy1 = DOT_Y(b) - DOT_Y(a);
+    int dx2 = DOT_X(c) - DOT_X(b);
+    int dy2 = DOT_Y(c) - DOT_Y(b);
+    int g1 = gcd(abs(dx1), abs(dy1));
+    int g2 = gcd(abs(dx2), abs(dy2));
+
+    return (dx1 / g1 == dx2 / g2) && (dy1 / g1 == dy2 / g2);
+}
+
+/*
+ * Score gained by adding a dot to a pattern. The score only depends on the
+ * last two dots, which keeps incremental scoring cheap.
+ *
+ * \param prev dot before the last one (0 if none)
+ * \param last last dot of the pattern (0 if the pattern is empty)
+ * \param next dot to add
+ * \return score of the step
+ */
+int score_step(const int prev, const int last, const int next)
+{
+    int score = 1;
+
+    if (last == 0) {
+        return score;
+    }
+
+    score += abs(DOT_X(next) - DOT_X(last)) + abs(DOT_Y(next) - DOT_Y(last));
+
+    if (prev > 0 && same_direction(prev, last, next) == 0) {
+        score++;
+    }
+
+    return score;
+}
+
+/*
+ * Score of a complete pattern
+ *
+ * \param pattern packed pattern
+ * \return score between 1 and MAX_SCORE
+ */
+int pattern_score(const packed_pattern_t pattern)
+{
+    int prev = 0;
+    int last = 0;
+    int score = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; p != 0; p >>= 4) {
+        int next = (int)(p & 0xf);
+
+        score += score_step(prev, last, next);
+        prev = last;
+        last = next;
+    }
+
+    return score;
+}
@@ -0,0 +1,23 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Simple pattern complexity score.
+ */
+
+#ifndef AUPATTERNS_SCORE_H
+#define AUPATTERNS_SCORE_H
+
+#include "pattern.h"
+
+/* Upper bound of pattern_score() for any pattern */
+#define MAX_SCORE 63
+
+int score_step(const int prev, const int last, const int next);
+int pattern_score(const packed_pattern_t pattern);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Translation invariant pattern shapes on square grids of any size.
+ *
+ * On an N x N grid many patterns are the same shape shifted around. A shape
+ * is enumerated only once, anchored with its first point at the centre of a
+ * (2N - 1) x (2N - 1) lattice, and every extension is kept within an N x N
+ * bounding box. A shape with a w x h bounding box then has (N - w + 1) *
+ * (N - h + 1) placements on the grid, all of them valid patterns, since the
+ * points a line passes over move together with the shape. This counts the
+ * patterns of the grid without visiting each of them.
+ *
+ * The blocker rule of the 3x3 grid generalizes to every point a line passes
+ * over: a move is legal only if all of those points are already used.
+ * Shapes which are the smallest of their rotations and reflections are
+ * counted separately as the classes of the full symmetry group.
+ */
+
+#include <stdlib.h>
+
+#include "shape.h"
+
+/* Side of the lattice a shape is enumerated on */
+#define LATTICE_SIZE (2 * MAX_SHAPE_GRID - 1)
+
+/* State of a shape enumeration */
+struct shape_walk {
+    int grid_size;
+    int max_length;
+    struct shape_counts *counts;
+    FILE *listing;
+    int x[MAX_SHAPE_LENGTH];
+    int y[MAX_SHAPE_LENGTH];
+    unsigned char used[LATTICE_SIZE][LATTICE_SIZE];
+};
+
+/*
+ * Parse a grid specification SIZE[:MAXLEN]
+ *
+ * \param spec grid specification (eg.: 4:6)
+ * \param grid_size points per side of the grid
+ * \param max_length longest shape to enumerate
+ * \return returns 0 on success, -1 on syntax error or unsupported size
+ */
+int parse_shape_grid(const char *spec, int *grid_size, int *max_length)
+{
+    char *rest;
+
+    *grid_size = (int)strtol(spec, &rest, 10);
+    if (*grid_size < 2 || *grid_size > MAX_SHAPE_GRID) {
+        return -1;
+    }
+
+    if (*rest == ':') {
+        *max_length = (int)strtol(rest + 1, &rest, 10);
+    } else if (*grid_size > 3) {
+        *max_length = SHAPE_DEFAULT_LENGTH;
+    } else {
+        *max_length = *grid_size * *grid_size;
+    }
+
+    if (*rest != '\0' || *max_length < 1 ||
+        *max_length > *grid_size * *grid_size)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int gcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+/*
+ * Check whether every point a line passes over is used
+ */
+static int move_allowed(const struct shape_walk *walk, const int from_x,
+                        const int from_y, const int to_x, const int to_y)
+{
+    int dx = to_x - from_x;
+    int dy = to_y - from_y;
+    int steps = gcd(abs(dx), abs(dy));
+    int k;
+
+    for (k = 1; k < steps; k++) {
+        if (walk->used[from_y + k * dy / steps][from_x + k * dx / steps] ==
+            0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Check whether a shape is the smallest of its rotations and reflections,
+ * comparing the offsets from the first point in order
+ */
+static int shape_is_canonical(const struct shape_walk *walk, const int len)
+{
+    int transform, i;
+
+    for (transform = 1; transform < 8; transform++) {
+        for (i = 1; i < len; i++) {
+            int x = walk->x[i] - walk->x[0];
+            int y = walk->y[i] - walk->y[0];
+            int t;
+
+            if (transform & 4) {
+                t = x;
+                x = y;
+                y = t;
+            }
+            if (transform & 2) {
+                x = -x;
+            }
+            if (transform & 1) {
+                y = -y;
+            }
+
+            t = (x - (walk->x[i] - walk->x[0])) * LATTICE_SIZE +
+                (y - (walk->y[i] - walk->y[0]));
+            if (t < 0) {
+                return 0;
+            }
+            if (t > 0) {
+                break;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Count one shape and write it placed in the top left corner
+ */
+static void visit_shape(struct shape_walk *walk, const int len,
+                        const int min_x, const int max_x,
+                        const int min_y, const int max_y)
+{
+    struct shape_counts *counts = walk->counts;
+    int n = walk->grid_size;
+    int i;
+    uint64_t placements = (uint64_t)(n - (max_x - min_x)) *
+                          (uint64_t)(n - (max_y - min_y));
+
+    counts->shapes[len]++;
+    counts->patterns[len] += placements;
+    if (shape_is_canonical(walk, len)) {
+        counts->classes[len]++;
+    }
+
+    if (walk->listing != NULL) {
+        fprintf(walk->listing, "%lu ", (unsigned long)placements);
+        for (i = 0; i < len; i++) {
+            int dot = (walk->y[i] - min_y) * n + (walk->x[i] - min_x) + 1;
+
+            if (n * n > 9 && i > 0) {
+                fputc('-', walk->listing);
+            }
+            fprintf(walk->listing, "%d", dot);
+        }
+        fputc('\n', walk->listing);
+    }
+
+    return;
+}
+
+/*
+ * Visit a shape and extend it by every legal point within the bounding box
+ */
+static void walk_shapes(struct shape_walk *walk, const int len,
+                        const int min_x, const int max_x,
+                        const int min_y, const int max_y)
+{
+    int reach = walk->grid_size - 1;
+    int last_x = walk->x[len - 1];
+    int last_y = walk->y[len - 1];
+    int x, y;
+
+    visit_shape(walk, len, min_x, max_x, min_y, max_y);
+    if (len == walk->max_length) {
+        return;
+    }
+
+    for (y = max_y - reach; y <= min_y + reach; y++) {
+        for (x = max_x - reach; x <= min_x + reach; x++) {
+            if (walk->used[y][x] ||
+                move_allowed(walk, last_x, last_y, x, y) == 0)
+            {
+                continue;
+            }
+
+            walk->x[len] = x;
+            walk->y[len] = y;
+            walk->used[y][x] = 1;
+            walk_shapes(walk, len + 1,
+                        x < min_x ? x : min_x, x > max_x ? x : max_x,
+                        y < min_y ? y : min_y, y > max_y ? y : max_y);
+            walk->used[y][x] = 0;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Count the translation invariant shapes of a grid, their classes under
+ * rotation and reflection and the patterns they cover
+ *
+ * \param grid_size points per side of the grid (2..MAX_SHAPE_GRID)
+ * \param max_length longest shape to enumerate
+ * \param counts counts to fill
+ * \param listing file to write every shape to, NULL for no listing
+ * \return returns 0 on success, -1 if out of memory
+ */
+int count_shapes(const int grid_size, const int max_length,
+                 struct shape_counts *counts, FILE *listing)
+{
+    struct shape_walk *walk;
+    int origin = grid_size - 1;
+    int i;
+
+    counts->grid_size = grid_size;
+    counts->max_length = max_length;
+    for (i = 0; i <= MAX_SHAPE_LENGTH; i++) {
+        counts->shapes[i] = 0;
+        counts->classes[i] = 0;
+        counts->patterns[i] = 0;
+    }
+
+    walk = calloc(1, sizeof(struct shape_walk));
+    if (walk == NULL) {
+        return -1;
+    }
+    walk->grid_size = grid_size;
+    walk->max_length = max_length;
+    walk->counts = counts;
+    walk->listing = listing;
+
+    /* every shape starts at the centre of the lattice */
+    walk->x[0] = origin;
+    walk->y[0] = origin;
+    walk->used[origin][origin] = 1;
+    walk_shapes(walk, 1, origin, origin, origin, origin);
+
+    free(walk);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Translation invariant pattern shapes on square grids of any size.
+ */
+
+#ifndef AUPATTERNS_SHAPE_H
+#define AUPATTERNS_SHAPE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Largest supported grid (points per side) */
+#define MAX_SHAPE_GRID 6
+
+/* Longest shape that can be enumerated */
+#define MAX_SHAPE_LENGTH (MAX_SHAPE_GRID * MAX_SHAPE_GRID)
+
+/* Default length limit on grids larger than the standard one */
+#define SHAPE_DEFAULT_LENGTH 6
+
+/* Number of shapes and of the patterns they cover by length */
+struct shape_counts {
+    int grid_size;
+    int max_length;
+    uint64_t shapes[MAX_SHAPE_LENGTH + 1];
+    uint64_t classes[MAX_SHAPE_LENGTH + 1];
+    uint64_t patterns[MAX_SHAPE_LENGTH + 1];
+};
+
+int parse_shape_grid(const char *spec, int *grid_size, int *max_length);
+int count_shapes(const int grid_size, const int max_length,
+                 struct shape_counts *counts, FILE *listing);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Keyed pseudo-random permutation of pattern ranks.
+ *
+ * A balanced Feistel network permutes the smallest power of four covering
+ * the domain. Values falling outside the domain are permuted again (cycle
+ * walking) until they land inside, which keeps the mapping a bijection on
+ * [0, domain). Since the covering range is less than four times the domain,
+ * a few rounds of walking are enough on average. Walking the indexes
+ * 0, 1, 2, ... through the permutation visits every rank exactly once in
+ * shuffled order without storing anything.
+ */
+
+#include "shuffle.h"
+
+/*
+ * SplitMix64 finalizer, used as the round function and for key scheduling
+ */
+static uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+}
+
+/*
+ * Set up a permutation of [0, domain)
+ *
+ * \param perm permutation to initialize
+ * \param domain number of values to permute, at least 1
+ * \param key key selecting the permutation
+ */
+void init_feistel_permutation(struct feistel_permutation *perm,
+                              const uint64_t domain, const uint64_t key)
+{
+    uint64_t state = key;
+    int i;
+
+    perm->domain = domain;
+    perm->half_bits = 1;
+    while (perm->half_bits < 32 &&
+           ((uint64_t)1 << (2 * perm->half_bits)) < domain)
+    {
+        perm->half_bits++;
+    }
+
+    for (i = 0; i < FEISTEL_ROUNDS; i++) {
+        state = mix64(state);
+        perm->round_keys[i] = state;
+    }
+
+    return;
+}
+
+/*
+ * Position of an index in the permuted order
+ *
+ * \param perm permutation
+ * \param index value in [0, domain)
+ * \return permuted value in [0, domain)
+ */
+uint64_t feistel_permute(const struct feistel_permutation *perm,
+                         const uint64_t index)
+{
+    uint64_t half_mask = ((uint64_t)1 << perm->half_bits) - 1;
+    uint64_t x = index;
+    int i;
+
+    do {
+        uint64_t left = x >> perm->half_bits;
+        uint64_t right = x & half_mask;
+
+        for (i = 0; i < FEISTEL_ROUNDS; i++) {
+            uint64_t next = left ^ (mix64(right ^ perm->round_keys[i]) &
+                                    half_mask);
+
+            left = right;
+            right = next;
+        }
+        x = (left << perm->half_bits) | right;
+    } while (x >= perm->domain);
+
+    return x;
+}
+
+/*
+ * Turn a user supplied key into a number, any string is accepted
+ *
+ * \param str key string
+ * \return numeric key
+ */
+uint64_t parse_shuffle_key(const char *str)
+{
+    uint64_t key = 0xcbf29ce484222325ULL;
+
+    for (; *str != '\0'; str++) {
+        key = (key ^ (unsigned char)*str) * 0x100000001b3ULL;
+    }
+
+    return key;
+}
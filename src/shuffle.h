@@ -0,0 +1,33 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Keyed pseudo-random permutation of pattern ranks.
+ */
+
+#ifndef AUPATTERNS_SHUFFLE_H
+#define AUPATTERNS_SHUFFLE_H
+
+#include <stdint.h>
+
+/* Number of Feistel rounds */
+#define FEISTEL_ROUNDS 6
+
+/* Keyed bijection on [0, domain) */
+struct feistel_permutation {
+    uint64_t domain;
+    int half_bits;
+    uint64_t round_keys[FEISTEL_ROUNDS];
+};
+
+void init_feistel_permutation(struct feistel_permutation *perm,
+                              const uint64_t domain, const uint64_t key);
+uint64_t feistel_permute(const struct feistel_permutation *perm,
+                         const uint64_t index);
+uint64_t parse_shuffle_key(const char *str);
+
+#endif
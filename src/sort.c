@@ -0,0 +1,327 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Radix sorting and grouping of packed patterns by small integer keys.
+ *
+ * The keys of a sort order are concatenated into one composite key of at
+ * most 32 bits which is then sorted by a least significant digit radix sort
+ * with 8 bit digits. Every pass is split into contiguous chunks, one for
+ * each thread: the threads build digit histograms of their chunk, the
+ * histograms are turned into per thread output offsets and the threads then
+ * scatter their chunk in order. Chunks are scattered in thread order, so the
+ * sort is stable.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "score.h"
+#include "sort.h"
+
+/* Bits of a radix digit */
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+/* Name and width in bits of every sort key */
+static const struct {
+    const char *name;
+    int bits;
+} sort_keys[] = {
+    { "length", 4 },
+    { "score", 6 },
+    { "start", 4 },
+    { "end", 4 },
+    { "dots", MAX_POINTS },
+};
+
+/* Shared state of the sort workers */
+struct radix_sort {
+    const struct sort_order *order;
+    packed_pattern_t *patterns;
+    packed_pattern_t *patterns_out;
+    uint32_t *keys;
+    uint32_t *keys_out;
+    size_t count;
+    int thread_count;
+    int shift;
+    size_t histogram[MAX_THREADS][RADIX_SIZE];
+};
+
+/*
+ * Parse a comma separated list of sort keys
+ *
+ * \param spec list of keys (eg.: length,score)
+ * \param order sort order to fill
+ * \return returns 0 on success, -1 on unknown key or too many keys
+ */
+int parse_sort_order(const char *spec, struct sort_order *order)
+{
+    const char *key = spec;
+    size_t len;
+    int bits = 0;
+    int i;
+
+    order->key_count = 0;
+
+    while (*key != '\0') {
+        len = strcspn(key, ",");
+
+        for (i = 0; i <= SORT_KEY_DOTS; i++) {
+            if (strlen(sort_keys[i].name) == len &&
+                strncmp(sort_keys[i].name, key, len) == 0)
+            {
+                break;
+            }
+        }
+
+        if (i > SORT_KEY_DOTS || order->key_count == MAX_SORT_KEYS) {
+            return -1;
+        }
+        order->keys[order->key_count++] = (enum sort_key)i;
+        bits += sort_keys[i].bits;
+
+        key += len;
+        if (*key == ',') {
+            key++;
+        }
+    }
+
+    return (order->key_count > 0 && bits <= 32) ? 0 : -1;
+}
+
+/*
+ * Name of a sort key
+ */
+const char *sort_key_name(const enum sort_key key)
+{
+    return sort_keys[key].name;
+}
+
+/*
+ * Value of a key for a pattern
+ *
+ * \param pattern packed pattern
+ * \param key key to compute
+ * \return key value, smaller than 1 << (width of the key)
+ */
+unsigned int pattern_sort_key(const packed_pattern_t pattern,
+                              const enum sort_key key)
+{
+    switch (key) {
+    case SORT_KEY_LENGTH:
+        return (unsigned int)packed_length(pattern);
+    case SORT_KEY_SCORE:
+        return (unsigned int)pattern_score(pattern);
+    case SORT_KEY_START:
+        return (unsigned int)PACKED_DOT(pattern, 0);
+    case SORT_KEY_END:
+        return (unsigned int)PACKED_DOT(pattern,
+                                        packed_length(pattern) - 1);
+    case SORT_KEY_DOTS:
+    default:
+        return packed_used_mask(pattern);
+    }
+}
+
+/*
+ * First and last row of the chunk of a thread
+ */
+static void thread_chunk(const struct radix_sort *sort, const int thread_index,
+                         size_t *begin, size_t *end)
+{
+    *begin = sort->count * (size_t)thread_index / (size_t)sort->thread_count;
+    *end = sort->count * (size_t)(thread_index + 1) /
+           (size_t)sort->thread_count;
+
+    return;
+}
+
+/*
+ * Compute the composite keys of a chunk
+ */
+static void radix_key_worker(void *ctx, const int thread_index)
+{
+    struct radix_sort *sort = ctx;
+    const struct sort_order *order = sort->order;
+    size_t begin, end, i;
+    int k;
+
+    thread_chunk(sort, thread_index, &begin, &end);
+
+    for (i = begin; i < end; i++) {
+        uint32_t key = 0;
+
+        for (k = 0; k < order->key_count; k++) {
+            key = (key << sort_keys[order->keys[k]].bits) |
+                  pattern_sort_key(sort->patterns[i], order->keys[k]);
+        }
+        sort->keys[i] = key;
+    }
+
+    return;
+}
+
+/*
+ * Build the digit histogram of a chunk
+ */
+static void radix_histogram_worker(void *ctx, const int thread_index)
+{
+    struct radix_sort *sort = ctx;
+    size_t *histogram = sort->histogram[thread_index];
+    size_t begin, end, i;
+
+    thread_chunk(sort, thread_index, &begin, &end);
+    memset(histogram, 0, RADIX_SIZE * sizeof(size_t));
+
+    for (i = begin; i < end; i++) {
+        histogram[(sort->keys[i] >> sort->shift) & (RADIX_SIZE - 1)]++;
+    }
+
+    return;
+}
+
+/*
+ * Scatter a chunk to its output offsets, keeping the order within digits
+ */
+static void radix_scatter_worker(void *ctx, const int thread_index)
+{
+    struct radix_sort *sort = ctx;
+    size_t *offset = sort->histogram[thread_index];
+    size_t begin, end, i;
+
+    thread_chunk(sort, thread_index, &begin, &end);
+
+    for (i = begin; i < end; i++) {
+        uint32_t key = sort->keys[i];
+        size_t pos = offset[(key >> sort->shift) & (RADIX_SIZE - 1)]++;
+
+        sort->keys_out[pos] = key;
+        sort->patterns_out[pos] = sort->patterns[i];
+    }
+
+    return;
+}
+
+/*
+ * Stable sort of packed patterns by a sort order
+ *
+ * \param patterns patterns to sort in place
+ * \param count number of patterns
+ * \param order keys to sort by
+ * \param thread_count number of threads to use
+ * \return returns 0 on success, -1 if out of memory
+ */
+int radix_sort_patterns(packed_pattern_t *patterns, const size_t count,
+                        const struct sort_order *order,
+                        const int thread_count)
+{
+    struct radix_sort *sort;
+    packed_pattern_t *pattern_swap;
+    uint32_t *key_swap;
+    int bits = 0;
+    int k, t, digit;
+
+    sort = malloc(sizeof(struct radix_sort));
+    if (sort == NULL) {
+        return -1;
+    }
+
+    sort->order = order;
+    sort->count = count;
+    sort->thread_count = (thread_count < 1) ? 1 :
+                         (thread_count > MAX_THREADS) ? MAX_THREADS :
+                         thread_count;
+    sort->patterns = patterns;
+    sort->patterns_out = malloc((count + 1) * sizeof(packed_pattern_t));
+    sort->keys = malloc((count + 1) * sizeof(uint32_t));
+    sort->keys_out = malloc((count + 1) * sizeof(uint32_t));
+    if (sort->patterns_out == NULL || sort->keys == NULL ||
+        sort->keys_out == NULL)
+    {
+        free(sort->patterns_out);
+        free(sort->keys);
+        free(sort->keys_out);
+        free(sort);
+        return -1;
+    }
+
+    for (k = 0; k < order->key_count; k++) {
+        bits += sort_keys[order->keys[k]].bits;
+    }
+
+    run_parallel(sort->thread_count, radix_key_worker, sort);
+
+    for (sort->shift = 0; sort->shift < bits; sort->shift += RADIX_BITS) {
+        size_t offset = 0;
+
+        run_parallel(sort->thread_count, radix_histogram_worker, sort);
+
+        /* digits in order, threads in order within a digit */
+        for (digit = 0; digit < RADIX_SIZE; digit++) {
+            for (t = 0; t < sort->thread_count; t++) {
+                size_t n = sort->histogram[t][digit];
+
+                sort->histogram[t][digit] = offset;
+                offset += n;
+            }
+        }
+
+        run_parallel(sort->thread_count, radix_scatter_worker, sort);
+
+        pattern_swap = sort->patterns;
+        sort->patterns = sort->patterns_out;
+        sort->patterns_out = pattern_swap;
+        key_swap = sort->keys;
+        sort->keys = sort->keys_out;
+        sort->keys_out = key_swap;
+    }
+
+    /* after an odd number of passes the result is in the scratch buffer */
+    if (sort->patterns != patterns) {
+        memcpy(patterns, sort->patterns, count * sizeof(packed_pattern_t));
+        sort->patterns_out = sort->patterns;
+    }
+
+    free(sort->patterns_out);
+    free(sort->keys);
+    free(sort->keys_out);
+    free(sort);
+    return 0;
+}
+
+/*
+ * Group sorted patterns by a key. The patterns must be sorted with the key
+ * as the first key of the sort order.
+ *
+ * \param patterns sorted patterns
+ * \param count number of patterns
+ * \param key key to group by
+ * \param group_start first row of every group (MAX_KEY_VALUES entries)
+ * \param group_value key value of every group (MAX_KEY_VALUES entries)
+ * \return number of groups
+ */
+size_t group_patterns(const packed_pattern_t *patterns, const size_t count,
+                      const enum sort_key key, size_t group_start[],
+                      unsigned int group_value[])
+{
+    size_t groups = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        unsigned int value = pattern_sort_key(patterns[i], key);
+
+        if (groups == 0 || group_value[groups - 1] != value) {
+            group_start[groups] = i;
+            group_value[groups] = value;
+            groups++;
+        }
+    }
+
+    return groups;
+}
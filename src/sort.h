@@ -0,0 +1,51 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Radix sorting and grouping of packed patterns by small integer keys.
+ */
+
+#ifndef AUPATTERNS_SORT_H
+#define AUPATTERNS_SORT_H
+
+#include <stddef.h>
+
+#include "pattern.h"
+
+/* Maximum number of keys in a sort order */
+#define MAX_SORT_KEYS 4
+
+/* Maximum number of distinct values of a single key */
+#define MAX_KEY_VALUES MASK_COUNT
+
+/* Keys patterns can be sorted and grouped by */
+enum sort_key {
+    SORT_KEY_LENGTH,
+    SORT_KEY_SCORE,
+    SORT_KEY_START,
+    SORT_KEY_END,
+    SORT_KEY_DOTS
+};
+
+/* Sort order, the first key is the most significant one */
+struct sort_order {
+    int key_count;
+    enum sort_key keys[MAX_SORT_KEYS];
+};
+
+int parse_sort_order(const char *spec, struct sort_order *order);
+const char *sort_key_name(const enum sort_key key);
+unsigned int pattern_sort_key(const packed_pattern_t pattern,
+                              const enum sort_key key);
+int radix_sort_patterns(packed_pattern_t *patterns, const size_t count,
+                        const struct sort_order *order,
+                        const int thread_count);
+size_t group_patterns(const packed_pattern_t *patterns, const size_t count,
+                      const enum sort_key key, size_t group_start[],
+                      unsigned int group_value[]);
+
+#endif
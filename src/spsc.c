@@ -0,0 +1,137 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Bounded lock-free single producer, single consumer ring of pointers.
+ *
+ * The blocking push waits while the ring is full, which gives backpressure:
+ * a fast producer is slowed down to the pace of its consumer instead of
+ * queueing without bounds. Waits spin for a while and then yield the
+ * processor.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include "spsc.h"
+
+/* Number of busy polls before yielding the processor */
+#define SPIN_COUNT 64
+
+/*
+ * Initialize a ring
+ *
+ * \param ring ring to initialize
+ * \param capacity number of slots, rounded up to a power of two
+ * \return returns 0 on success, -1 if out of memory
+ */
+int spsc_init(struct spsc_ring *ring, const size_t capacity)
+{
+    size_t size = 1;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    ring->slots = malloc(size * sizeof(void *));
+    if (ring->slots == NULL) {
+        return -1;
+    }
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return 0;
+}
+
+/*
+ * Release the slots of a ring
+ *
+ * \param ring ring to free
+ */
+void spsc_free(struct spsc_ring *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+
+    return;
+}
+
+/*
+ * Add an item if there is room, producer side only
+ *
+ * \return returns 1 if the item was added, 0 if the ring is full
+ */
+int spsc_try_push(struct spsc_ring *ring, void *item)
+{
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head > ring->mask) {
+        return 0;
+    }
+
+    ring->slots[tail & ring->mask] = item;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/*
+ * Take an item if there is one, consumer side only
+ *
+ * \return returns 1 if an item was taken, 0 if the ring is empty
+ */
+int spsc_try_pop(struct spsc_ring *ring, void **item)
+{
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return 0;
+    }
+
+    *item = ring->slots[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/*
+ * Add an item, waiting while the ring is full
+ */
+void spsc_push(struct spsc_ring *ring, void *item)
+{
+    int spins = 0;
+
+    while (spsc_try_push(ring, item) == 0) {
+        if (++spins >= SPIN_COUNT) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Take an item, waiting while the ring is empty
+ */
+void *spsc_pop(struct spsc_ring *ring)
+{
+    void *item;
+    int spins = 0;
+
+    while (spsc_try_pop(ring, &item) == 0) {
+        if (++spins >= SPIN_COUNT) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+
+    return item;
+}
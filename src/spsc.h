@@ -0,0 +1,41 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Bounded lock-free single producer, single consumer ring of pointers.
+ */
+
+#ifndef AUPATTERNS_SPSC_H
+#define AUPATTERNS_SPSC_H
+
+#include <stddef.h>
+
+/* Assumed cache line size, keeps producer and consumer data apart */
+#define CACHE_LINE 64
+
+/*
+ * Ring buffer of pointers. The producer only writes tail, the consumer only
+ * writes head, so no locks are needed.
+ */
+struct spsc_ring {
+    void **slots;
+    size_t mask;
+    char pad0[CACHE_LINE];
+    size_t head;
+    char pad1[CACHE_LINE];
+    size_t tail;
+    char pad2[CACHE_LINE];
+};
+
+int spsc_init(struct spsc_ring *ring, const size_t capacity);
+void spsc_free(struct spsc_ring *ring);
+int spsc_try_push(struct spsc_ring *ring, void *item);
+int spsc_try_pop(struct spsc_ring *ring, void **item);
+void spsc_push(struct spsc_ring *ring, void *item);
+void *spsc_pop(struct spsc_ring *ring);
+
+#endif
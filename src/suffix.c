@@ -0,0 +1,363 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern tree output from memoized suffix blocks.
+ *
+ * The completions below a pattern only depend on its used dots and its last
+ * dot, so in the pattern tree output order the subtree of a state is the
+ * same list of lines under every prefix reaching it, only the first dots of
+ * the lines differ. The subtrees of the states at one depth are generated
+ * once into a cache, with the line lengths alongside, and every later visit
+ * copies the block and overwrites the prefix bytes of its lines. The depth
+ * is the one generating the least text whose blocks fit the budget: deeper
+ * states are reached by more prefixes, but more of the tree above them is
+ * listed line by line.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "probes.h"
+#include "suffix.h"
+
+/* Blocks of one depth and the output buffer */
+struct suffix_cache {
+    const struct transition_table *table;
+    FILE *output_file;
+    int depth;
+    size_t text_size;
+    char *text;
+    uint8_t *lengths;
+    char *output;
+    size_t fill;
+    uint32_t bytes[MASK_COUNT][MAX_POINTS + 1];
+    uint32_t lines[MASK_COUNT][MAX_POINTS + 1];
+    uint32_t paths[MASK_COUNT][MAX_POINTS + 1];
+    uint32_t text_offset[MASK_COUNT][MAX_POINTS + 1];
+    uint32_t line_offset[MASK_COUNT][MAX_POINTS + 1];
+    unsigned char built[MASK_COUNT][MAX_POINTS + 1];
+};
+
+/* Destination of the lines of a subtree */
+struct suffix_sink {
+    char *text;
+    uint8_t *lengths;
+    size_t fill;
+    uint32_t line_count;
+};
+
+static void flush_output(struct suffix_cache *cache)
+{
+    fwrite(cache->output, 1, cache->fill, cache->output_file);
+    AUP_PROBE1(output_flush, cache->fill);
+    cache->fill = 0;
+
+    return;
+}
+
+/*
+ * Count the prefixes reaching every state, and the lines and bytes of the
+ * subtree of every state. Children always have a larger used dot set, so
+ * one pass up and one pass down over the sets are enough.
+ */
+static void measure_subtrees(struct suffix_cache *cache)
+{
+    const struct transition_table *table = cache->table;
+    unsigned int mask;
+    int last, next;
+
+    memset(cache->paths, 0, sizeof(cache->paths));
+    cache->paths[0][0] = 1;
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t children = table->next[mask][last];
+
+            if (cache->paths[mask][last] == 0) {
+                continue;
+            }
+            for (; children != 0; children &= children - 1) {
+                next = __builtin_ctz(children) + 1;
+                cache->paths[mask | DOT_BIT(next)][next] +=
+                    cache->paths[mask][last];
+            }
+        }
+    }
+
+    for (mask = MASK_COUNT; mask-- > 0;) {
+        uint32_t line_size = (uint32_t)popcount_mask(mask) + 2;
+
+        for (last = 0; last <= MAX_POINTS; last++) {
+            uint16_t children = table->next[mask][last];
+
+            cache->bytes[mask][last] = 0;
+            cache->lines[mask][last] = 0;
+            for (; children != 0; children &= children - 1) {
+                next = __builtin_ctz(children) + 1;
+                cache->bytes[mask][last] += line_size +
+                    cache->bytes[mask | DOT_BIT(next)][next];
+                cache->lines[mask][last] += 1 +
+                    cache->lines[mask | DOT_BIT(next)][next];
+            }
+        }
+    }
+
+    return;
+}
+
+/*
+ * Pick the depth generating the least text within the budget and lay out
+ * the blocks of its states
+ *
+ * \return size of the blocks with their line lengths
+ */
+static size_t plan_blocks(struct suffix_cache *cache, const size_t budget)
+{
+    uint64_t block_size[MAX_POINTS + 1] = { 0 };
+    uint64_t listed[MAX_POINTS + 1] = { 0 };
+    uint64_t best = UINT64_MAX;
+    uint32_t text = 0, lines = 0;
+    unsigned int mask;
+    int depth, last;
+
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        depth = popcount_mask(mask);
+        for (last = 0; last <= MAX_POINTS; last++) {
+            if (cache->paths[mask][last] == 0) {
+                continue;
+            }
+            block_size[depth] += cache->bytes[mask][last] +
+                                 cache->lines[mask][last];
+            listed[depth] += (uint64_t)cache->paths[mask][last] *
+                             (depth + 1);
+        }
+    }
+
+    /* the lines down to the depth are listed, everything below is cached */
+    cache->depth = MAX_POINTS;
+    for (depth = 1; depth <= MAX_POINTS; depth++) {
+        listed[depth] += listed[depth - 1];
+        if (block_size[depth] <= budget &&
+            listed[depth] + block_size[depth] < best)
+        {
+            best = listed[depth] + block_size[depth];
+            cache->depth = depth;
+        }
+    }
+
+    for (mask = 0; mask < MASK_COUNT; mask++) {
+        if (popcount_mask(mask) != cache->depth) {
+            continue;
+        }
+        for (last = 0; last <= MAX_POINTS; last++) {
+            if (cache->paths[mask][last] == 0) {
+                continue;
+            }
+            cache->text_offset[mask][last] = text;
+            cache->line_offset[mask][last] = lines;
+            text += cache->bytes[mask][last];
+            lines += cache->lines[mask][last];
+        }
+    }
+    memset(cache->built, 0, sizeof(cache->built));
+    cache->text_size = text;
+
+    return (size_t)text + lines;
+}
+
+/*
+ * Generate the lines of a subtree in pattern tree output order
+ */
+static void generate_subtree(struct suffix_cache *cache,
+                             struct suffix_sink *sink, char *line,
+                             const unsigned int mask, const int last,
+                             const int depth)
+{
+    uint16_t candidates = cache->table->next[mask][last];
+    uint16_t children;
+
+    for (children = candidates; children != 0; children &= children - 1) {
+        char *dst = sink->text + sink->fill;
+
+        memcpy(dst, line, depth);
+        dst[depth] = (char)('1' + __builtin_ctz(children));
+        dst[depth + 1] = '\n';
+        sink->fill += depth + 2;
+        sink->lengths[sink->line_count++] = (uint8_t)(depth + 2);
+    }
+
+    for (children = candidates; children != 0; children &= children - 1) {
+        int next = __builtin_ctz(children) + 1;
+
+        line[depth] = (char)('0' + next);
+        generate_subtree(cache, sink, line, mask | DOT_BIT(next), next,
+                         depth + 1);
+    }
+
+    return;
+}
+
+/*
+ * Copy the block of a state to the output with the prefix of the line
+ */
+static void copy_block(struct suffix_cache *cache, char *line,
+                       const unsigned int mask, const int last)
+{
+    const char *text = cache->text + cache->text_offset[mask][last];
+    const uint8_t *lengths = cache->lengths + cache->line_offset[mask][last];
+    uint32_t line_count = cache->lines[mask][last];
+    size_t patch = (size_t)cache->depth - 1;
+    uint32_t first = 0;
+
+    if (cache->built[mask][last] == 0) {
+        struct suffix_sink sink;
+
+        sink.text = cache->text + cache->text_offset[mask][last];
+        sink.lengths = cache->lengths + cache->line_offset[mask][last];
+        sink.fill = 0;
+        sink.line_count = 0;
+        generate_subtree(cache, &sink, line, mask, last, cache->depth);
+        cache->built[mask][last] = 1;
+    }
+
+    /* runs of whole lines fitting the output buffer */
+    while (first < line_count) {
+        size_t run = 0;
+        uint32_t end = first;
+        char *dst = cache->output + cache->fill;
+
+        while (end < line_count &&
+               cache->fill + run + lengths[end] <= SUFFIX_OUTPUT_SIZE)
+        {
+            run += lengths[end++];
+        }
+        if (end == first) {
+            flush_output(cache);
+            continue;
+        }
+
+        memcpy(dst, text, run);
+        text += run;
+        cache->fill += run;
+        if (patch > 0) {
+            for (; first < end; first++) {
+                memcpy(dst, line, patch);
+                dst += lengths[first];
+            }
+        }
+        first = end;
+    }
+
+    return;
+}
+
+/*
+ * List the tree down to the cached depth, then copy the blocks
+ */
+static void write_subtree(struct suffix_cache *cache, char *line,
+                          const unsigned int mask, const int last,
+                          const int depth)
+{
+    uint16_t candidates = cache->table->next[mask][last];
+    uint16_t children;
+
+    if (depth == cache->depth) {
+        copy_block(cache, line, mask, last);
+        return;
+    }
+
+    for (children = candidates; children != 0; children &= children - 1) {
+        char *dst;
+
+        if (cache->fill + depth + 2 > SUFFIX_OUTPUT_SIZE) {
+            flush_output(cache);
+        }
+        dst = cache->output + cache->fill;
+        memcpy(dst, line, depth);
+        dst[depth] = (char)('1' + __builtin_ctz(children));
+        dst[depth + 1] = '\n';
+        cache->fill += depth + 2;
+    }
+
+    for (children = candidates; children != 0; children &= children - 1) {
+        int next = __builtin_ctz(children) + 1;
+
+        line[depth] = (char)('0' + next);
+        write_subtree(cache, line, mask | DOT_BIT(next), next, depth + 1);
+    }
+
+    return;
+}
+
+/*
+ * Plan the blocks of a transition table and allocate them, so a caller can
+ * still fall back to the pattern writer before anything is written
+ *
+ * \param table legal transitions to follow, kept until the cache is freed
+ * \param budget memory for the cached blocks in bytes
+ * \return the cache, NULL if out of memory
+ */
+struct suffix_cache *create_suffix_cache(const struct transition_table *table,
+                                         const size_t budget)
+{
+    struct suffix_cache *cache;
+    size_t size;
+
+    cache = malloc(sizeof(struct suffix_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->table = table;
+    cache->output_file = NULL;
+    cache->fill = 0;
+
+    measure_subtrees(cache);
+    size = plan_blocks(cache, budget);
+    AUP_PROBE2(suffix_blocks, cache->depth, size);
+
+    cache->text = malloc(size > 0 ? size : 1);
+    cache->output = malloc(SUFFIX_OUTPUT_SIZE);
+    if (cache->text == NULL || cache->output == NULL) {
+        free_suffix_cache(cache);
+        return NULL;
+    }
+    cache->lengths = (uint8_t *)cache->text + cache->text_size;
+
+    return cache;
+}
+
+/*
+ * Write every pattern in pattern tree output order, the same text as the
+ * pattern writer without a filter or hash
+ *
+ * \param cache blocks to generate and copy the lines from
+ * \param output_file file to write to
+ */
+void write_suffix_blocks(struct suffix_cache *cache, FILE *output_file)
+{
+    char line[MAX_POINTS + 1];
+
+    cache->output_file = output_file;
+    write_subtree(cache, line, 0, 0, 0);
+    flush_output(cache);
+
+    return;
+}
+
+/*
+ * Release a cache
+ *
+ * \param cache cache to free
+ */
+void free_suffix_cache(struct suffix_cache *cache)
+{
+    free(cache->text);
+    free(cache->output);
+    free(cache);
+
+    return;
+}
@@ -0,0 +1,30 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern tree output from memoized suffix blocks.
+ */
+
+#ifndef AUPATTERNS_SUFFIX_H
+#define AUPATTERNS_SUFFIX_H
+
+#include <stdio.h>
+
+#include "pattern.h"
+
+/* Size of the output buffer */
+#define SUFFIX_OUTPUT_SIZE (1 << 20)
+
+/* Planned and allocated blocks of one transition table */
+struct suffix_cache;
+
+struct suffix_cache *create_suffix_cache(const struct transition_table *table,
+                                         const size_t budget);
+void write_suffix_blocks(struct suffix_cache *cache, FILE *output_file);
+void free_suffix_cache(struct suffix_cache *cache);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Struct-of-arrays pattern table for analysis over the whole pattern space.
+ *
+ * The table is filled by prefix shards. Every shard holds the patterns
+ * starting with a given pair of dots (or the single dot pattern when both
+ * dots are the same). A first parallel pass counts the matching patterns of
+ * every shard, so that each shard knows its row offset and the second pass
+ * can fill the columns in parallel without any locking.
+ */
+
+#include <stdlib.h>
+
+#include "parallel.h"
+#include "probes.h"
+#include "table.h"
+
+/* Shared state of the build workers */
+struct table_build {
+    const struct transition_table *transitions;
+    const struct pattern_filter *filter;
+    struct pattern_table *table;
+    size_t shard_count[TABLE_SHARDS];
+    size_t shard_offset[TABLE_SHARDS];
+    int next_shard;
+    int fill;
+};
+
+/* Per shard state of the enumeration callback */
+struct shard_visit {
+    const struct pattern_filter *filter;
+    struct pattern_table *table;
+    size_t row;
+    int fill;
+};
+
+/*
+ * Count or store one enumerated pattern
+ */
+static void shard_visit_pattern(void *ctx, const packed_pattern_t pattern,
+                                const unsigned int used_mask)
+{
+    struct shard_visit *visit = ctx;
+    struct pattern_table *table = visit->table;
+    int len;
+
+    if (pattern_filter_match(visit->filter, pattern) == 0) {
+        return;
+    }
+
+    if (visit->fill > 0) {
+        len = packed_length(pattern);
+        table->length[visit->row] = (uint8_t)len;
+        table->digits[visit->row] = pattern;
+        table->used[visit->row] = (uint16_t)used_mask;
+        table->start[visit->row] = (uint8_t)PACKED_DOT(pattern, 0);
+        table->end[visit->row] = (uint8_t)PACKED_DOT(pattern, len - 1);
+    }
+    visit->row++;
+
+    return;
+}
+
+/*
+ * Walk the patterns of one prefix shard
+ *
+ * \return number of matching patterns in the shard
+ */
+static size_t walk_shard(struct table_build *build, const int shard,
+                         const size_t offset)
+{
+    const struct transition_table *t = build->transitions;
+    struct shard_visit visit;
+    int first = shard / MAX_POINTS + 1;
+    int second = shard % MAX_POINTS + 1;
+
+    visit.filter = build->filter;
+    visit.table = build->table;
+    visit.row = offset;
+    visit.fill = build->fill;
+
+    if ((t->next[0][0] & DOT_BIT(first)) == 0) {
+        return 0;
+    }
+
+    if (first == second) {
+        shard_visit_pattern(&visit, (packed_pattern_t)first, DOT_BIT(first));
+    } else if (t->next[DOT_BIT(first)][first] & DOT_BIT(second)) {
+        enumerate_from(t, (packed_pattern_t)(first | (second << 4)),
+                       build->filter->max_length, shard_visit_pattern, &visit);
+    }
+
+    return visit.row - offset;
+}
+
+/*
+ * Worker of both build passes, shards are claimed one by one
+ */
+static void table_build_worker(void *ctx, const int thread_index)
+{
+    struct table_build *build = ctx;
+    int shard;
+
+    (void)thread_index;
+
+    while ((shard = __sync_fetch_and_add(&build->next_shard, 1)) <
+           TABLE_SHARDS)
+    {
+        if (build->fill > 0) {
+            walk_shard(build, shard, build->shard_offset[shard]);
+        } else {
+            build->shard_count[shard] = walk_shard(build, shard, 0);
+        }
+        AUP_PROBE2(shard_done, shard, build->shard_count[shard]);
+    }
+
+    return;
+}
+
+/*
+ * Materialize all patterns (or the ones matching a filter) into a table
+ *
+ * \param table table to fill, must be freed with pattern_table_free()
+ * \param block_matrix transition matrix to use
+ * \param filter filter for the patterns to store
+ * \param thread_count number of threads to fill the table with
+ * \return returns 0 on success, -1 if out of memory
+ */
+int pattern_table_build(struct pattern_table *table, int block_matrix[][10],
+                        const struct pattern_filter *filter,
+                        const int thread_count)
+{
+    struct transition_table *transitions;
+    struct table_build *build;
+    size_t count = 0;
+    int i;
+
+    table->count = 0;
+    table->length = NULL;
+    table->digits = NULL;
+    table->used = NULL;
+    table->start = NULL;
+    table->end = NULL;
+
+    transitions = malloc(sizeof(struct transition_table));
+    build = malloc(sizeof(struct table_build));
+    if (transitions == NULL || build == NULL) {
+        free(transitions);
+        free(build);
+        return -1;
+    }
+    build_transition_table(block_matrix, transitions);
+
+    build->transitions = transitions;
+    build->filter = filter;
+    build->table = table;
+
+    AUP_PROBE1(table_start, thread_count);
+
+    /* first pass: size of every shard */
+    build->next_shard = 0;
+    build->fill = 0;
+    run_parallel(thread_count, table_build_worker, build);
+
+    for (i = 0; i < TABLE_SHARDS; i++) {
+        build->shard_offset[i] = count;
+        count += build->shard_count[i];
+    }
+
+    table->length = malloc(count + 1);
+    table->digits = malloc((count + 1) * sizeof(packed_pattern_t));
+    table->used = malloc((count + 1) * sizeof(uint16_t));
+    table->start = malloc(count + 1);
+    table->end = malloc(count + 1);
+    if (table->length == NULL || table->digits == NULL ||
+        table->used == NULL || table->start == NULL || table->end == NULL)
+    {
+        pattern_table_free(table);
+        free(transitions);
+        free(build);
+        return -1;
+    }
+
+    /* second pass: every shard fills its own rows */
+    build->next_shard = 0;
+    build->fill = 1;
+    run_parallel(thread_count, table_build_worker, build);
+    table->count = count;
+    AUP_PROBE1(table_end, count);
+
+    free(transitions);
+    free(build);
+    return 0;
+}
+
+/*
+ * Release the columns of a table
+ *
+ * \param table table to free
+ */
+void pattern_table_free(struct pattern_table *table)
+{
+    free(table->length);
+    free(table->digits);
+    free(table->used);
+    free(table->start);
+    free(table->end);
+
+    table->count = 0;
+    table->length = NULL;
+    table->digits = NULL;
+    table->used = NULL;
+    table->start = NULL;
+    table->end = NULL;
+
+    return;
+}
+
+/*
+ * Count the rows of a byte column equal to a value. The loop is kept simple
+ * so that the compiler can vectorize it.
+ *
+ * \param column column to scan (length, start or end)
+ * \param count number of rows
+ * \param value value to look for
+ * \return number of matching rows
+ */
+size_t pattern_table_count_eq(const uint8_t *column, const size_t count,
+                              const uint8_t value)
+{
+    size_t matches = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        matches += (column[i] == value);
+    }
+
+    return matches;
+}
+
+/*
+ * Count the patterns using a given dot
+ *
+ * \param table table to scan
+ * \param dot dot to look for
+ * \return number of patterns containing the dot
+ */
+size_t pattern_table_count_used(const struct pattern_table *table,
+                                const int dot)
+{
+    const uint16_t *used = table->used;
+    uint16_t bit = (uint16_t)DOT_BIT(dot);
+    size_t matches = 0;
+    size_t i;
+
+    for (i = 0; i < table->count; i++) {
+        matches += ((used[i] & bit) != 0);
+    }
+
+    return matches;
+}
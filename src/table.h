@@ -0,0 +1,42 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Struct-of-arrays pattern table for analysis over the whole pattern space.
+ */
+
+#ifndef AUPATTERNS_TABLE_H
+#define AUPATTERNS_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pattern.h"
+
+/* Number of prefix shards, one for every (first dot, second dot) pair */
+#define TABLE_SHARDS (MAX_POINTS * MAX_POINTS)
+
+/* Patterns stored column by column, row i of every column is pattern i */
+struct pattern_table {
+    size_t count;
+    uint8_t *length;
+    packed_pattern_t *digits;
+    uint16_t *used;
+    uint8_t *start;
+    uint8_t *end;
+};
+
+int pattern_table_build(struct pattern_table *table, int block_matrix[][10],
+                        const struct pattern_filter *filter,
+                        const int thread_count);
+void pattern_table_free(struct pattern_table *table);
+size_t pattern_table_count_eq(const uint8_t *column, const size_t count,
+                              const uint8_t value);
+size_t pattern_table_count_used(const struct pattern_table *table,
+                                const int dot);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Queries answered from the tables precomputed at build time. The tables
+ * themselves are generated into embedded_tables.c by gentables.
+ */
+
+#include "tables.h"
+
+/*
+ * Count the patterns of every length that use only the given dots. This is
+ * the same as the summary of the -g pattern tree when no edge is disabled.
+ *
+ * \param dots mask of the available dots
+ * \param pattern_count array to store the count for each length of patterns
+ */
+void embedded_subset_lengths(const unsigned int dots, int pattern_count[])
+{
+    unsigned int subset;
+    int i;
+
+    for (i = 0; i < MAX_POINTS; i++) {
+        pattern_count[i] = 0;
+    }
+
+    /* walk all non-empty subsets of the available dots */
+    for (subset = dots; subset != 0; subset = (subset - 1) & dots) {
+        pattern_count[popcount_mask(subset) - 1] +=
+            (int)embedded_subset_count[subset];
+    }
+
+    return;
+}
@@ -0,0 +1,32 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Tables of the standard 3x3 grid precomputed at build time by gentables.
+ */
+
+#ifndef AUPATTERNS_TABLES_H
+#define AUPATTERNS_TABLES_H
+
+#include "rank.h"
+
+/* Transitions and per state counts of pattern_block_matrix */
+extern const struct rank_table embedded_rank_table;
+
+/* Number of patterns using exactly the dots of a mask */
+extern const uint32_t embedded_subset_count[MASK_COUNT];
+
+/* Number of patterns of every length */
+extern const uint32_t embedded_length_count[MAX_POINTS + 1];
+
+/* Number of patterns and the score of every pattern indexed by rank */
+extern const uint32_t embedded_pattern_count;
+extern const uint8_t embedded_scores[];
+
+void embedded_subset_lengths(const unsigned int dots, int pattern_count[]);
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Versioned table sets which can be replaced while they are read.
+ *
+ * A long running process changes grid layouts and rules without stopping
+ * its queries. The new table set is built beforehand on any thread, and
+ * publishing it is a single atomic pointer exchange. Readers never lock or
+ * wait: pinning stores the global epoch in the reader's own cache line and
+ * loads the current set. A replaced set is retired with the epoch after the
+ * exchange and freed once no reader is pinned in an older epoch, so the
+ * writer never waits for readers either and reclaiming is deferred to the
+ * next publish (or an explicit reclaim).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tableset.h"
+
+/*
+ * Build a table set
+ *
+ * \param block_matrix transition matrix of the grid layout
+ * \param rule_spec drawing rule as for -R, NULL for none
+ * \param policy_spec sub-pattern policy as for -F, NULL for none
+ * \return the new set with version 0, NULL if a specification is invalid,
+ *         both are given or out of memory
+ */
+struct table_set *build_table_set(int block_matrix[][10],
+                                  const char *rule_spec,
+                                  const char *policy_spec)
+{
+    struct table_set *set;
+
+    if (rule_spec != NULL && policy_spec != NULL) {
+        return NULL;
+    }
+
+    set = malloc(sizeof(struct table_set));
+    if (set == NULL) {
+        return NULL;
+    }
+
+    set->version = 0;
+    memcpy(set->block_matrix, block_matrix, sizeof(set->block_matrix));
+    build_rank_table(set->block_matrix, &set->ranks);
+    set->has_rule = 0;
+    set->retire_epoch = 0;
+    set->next_retired = NULL;
+
+    if (rule_spec != NULL) {
+        if (parse_drawing_rule(rule_spec, &set->rule) < 0) {
+            free(set);
+            return NULL;
+        }
+        set->has_rule = 1;
+    } else if (policy_spec != NULL) {
+        if (parse_subpattern_policy(policy_spec, &set->policy) < 0) {
+            free(set);
+            return NULL;
+        }
+        /* the rule points into the set, so it moves with it */
+        init_policy_rule(&set->policy, &set->rule);
+        set->has_rule = 1;
+    }
+
+    return set;
+}
+
+void free_table_set(struct table_set *set)
+{
+    free(set);
+
+    return;
+}
+
+/*
+ * Initialize a domain with its first table set
+ *
+ * \param domain domain to initialize
+ * \param initial first table set, owned by the domain from now on
+ */
+void init_table_domain(struct table_domain *domain,
+                       struct table_set *initial)
+{
+    int i;
+
+    initial->version = 1;
+    domain->current = initial;
+    domain->epoch = 1;
+    pthread_mutex_init(&domain->writer_lock, NULL);
+    domain->retired = NULL;
+    domain->published = 1;
+    domain->reclaimed = 0;
+    for (i = 0; i < MAX_THREADS; i++) {
+        domain->readers[i].epoch = 0;
+    }
+
+    return;
+}
+
+/*
+ * Free every set of a domain, no reader may be pinned
+ *
+ * \param domain domain to free
+ */
+void free_table_domain(struct table_domain *domain)
+{
+    struct table_set *set;
+
+    while ((set = domain->retired) != NULL) {
+        domain->retired = set->next_retired;
+        free_table_set(set);
+    }
+    free_table_set(domain->current);
+    domain->current = NULL;
+    pthread_mutex_destroy(&domain->writer_lock);
+
+    return;
+}
+
+/*
+ * Pin the current table set. The set stays valid until the reader unpins,
+ * even if a new one is published meanwhile.
+ *
+ * \param domain domain to read
+ * \param reader index of the reader (thread), below MAX_THREADS
+ * \return the current table set
+ */
+const struct table_set *table_set_pin(struct table_domain *domain,
+                                      const int reader)
+{
+    /* the epoch must be visible before the set is loaded, a publisher
+     * which misses it has exchanged the set before this load */
+    __atomic_store_n(&domain->readers[reader].epoch,
+                     __atomic_load_n(&domain->epoch, __ATOMIC_SEQ_CST),
+                     __ATOMIC_SEQ_CST);
+
+    return __atomic_load_n(&domain->current, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Release the table set pinned by a reader
+ *
+ * \param domain domain read
+ * \param reader index of the reader
+ */
+void table_set_unpin(struct table_domain *domain, const int reader)
+{
+    __atomic_store_n(&domain->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+
+    return;
+}
+
+/*
+ * Free the retired sets no reader can hold, writer lock held
+ *
+ * \return number of retired sets still held
+ */
+static int reclaim_retired(struct table_domain *domain)
+{
+    struct table_set **link = &domain->retired;
+    uint64_t oldest = UINT64_MAX;
+    int pending = 0;
+    int i;
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        uint64_t epoch = __atomic_load_n(&domain->readers[i].epoch,
+                                         __ATOMIC_SEQ_CST);
+
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    /* readers pinned since the retirement can only hold newer sets */
+    while (*link != NULL) {
+        struct table_set *set = *link;
+
+        if (set->retire_epoch <= oldest) {
+            *link = set->next_retired;
+            free_table_set(set);
+            domain->reclaimed++;
+        } else {
+            link = &set->next_retired;
+            pending++;
+        }
+    }
+
+    return pending;
+}
+
+/*
+ * Replace the current table set. Readers pinned to the old set keep using
+ * it, it is freed once the last of them unpins.
+ *
+ * \param domain domain to update
+ * \param set new table set, owned by the domain from now on
+ */
+void table_set_publish(struct table_domain *domain, struct table_set *set)
+{
+    struct table_set *old;
+
+    pthread_mutex_lock(&domain->writer_lock);
+
+    set->version = ++domain->published;
+    old = __atomic_exchange_n(&domain->current, set, __ATOMIC_SEQ_CST);
+    old->retire_epoch = __atomic_add_fetch(&domain->epoch, 1,
+                                           __ATOMIC_SEQ_CST);
+    old->next_retired = domain->retired;
+    domain->retired = old;
+    reclaim_retired(domain);
+
+    pthread_mutex_unlock(&domain->writer_lock);
+
+    return;
+}
+
+/*
+ * Free the retired table sets no reader holds any more
+ *
+ * \param domain domain to clean up
+ * \return number of retired sets still held by readers
+ */
+int table_set_reclaim(struct table_domain *domain)
+{
+    int pending;
+
+    pthread_mutex_lock(&domain->writer_lock);
+    pending = reclaim_retired(domain);
+    pthread_mutex_unlock(&domain->writer_lock);
+
+    return pending;
+}
@@ -0,0 +1,68 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Versioned table sets which can be replaced while they are read.
+ */
+
+#ifndef AUPATTERNS_TABLESET_H
+#define AUPATTERNS_TABLESET_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "parallel.h"
+#include "policy.h"
+#include "rank.h"
+#include "spsc.h"
+
+/* Everything a query needs about one grid layout and rule configuration */
+struct table_set {
+    unsigned long version;
+    int block_matrix[10][10];
+    struct rank_table ranks;
+    int has_rule;
+    struct drawing_rule rule;
+    struct subpattern_policy policy;
+    uint64_t retire_epoch;
+    struct table_set *next_retired;
+};
+
+/* Epoch a reader pinned the current set in, 0 if it holds none */
+struct table_reader {
+    uint64_t epoch;
+    char pad[CACHE_LINE - sizeof(uint64_t)];
+};
+
+/*
+ * The current table set and the replaced ones some reader may still hold.
+ * Readers are identified by an index below MAX_THREADS, one per thread.
+ */
+struct table_domain {
+    struct table_set *current;
+    uint64_t epoch;
+    pthread_mutex_t writer_lock;
+    struct table_set *retired;
+    unsigned long published;
+    unsigned long reclaimed;
+    struct table_reader readers[MAX_THREADS];
+};
+
+struct table_set *build_table_set(int block_matrix[][10],
+                                  const char *rule_spec,
+                                  const char *policy_spec);
+void free_table_set(struct table_set *set);
+void init_table_domain(struct table_domain *domain,
+                       struct table_set *initial);
+void free_table_domain(struct table_domain *domain);
+const struct table_set *table_set_pin(struct table_domain *domain,
+                                      const int reader);
+void table_set_unpin(struct table_domain *domain, const int reader);
+void table_set_publish(struct table_domain *domain, struct table_set *set);
+int table_set_reclaim(struct table_domain *domain);
+
+#endif
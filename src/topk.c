@@ -0,0 +1,400 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Parallel selection of the best patterns under any scoring function.
+ *
+ * Scores which do not decompose along the path (eg.: the number of
+ * crossing strokes) can not prune the enumeration, so every matching
+ * pattern is scored. The prefix shards of the pattern table are claimed by
+ * the threads, and every thread keeps its k best patterns in a bounded min
+ * heap. The k-th best score of any thread is a lower bound of the k-th best
+ * score overall, so the largest one is shared and anything below it is
+ * rejected without touching a heap. The heaps are merged at the end, so the
+ * memory is O(k * threads) no matter how many patterns are scored.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "score.h"
+#include "table.h"
+#include "topk.h"
+
+/* Column and row of a dot on the 3x3 grid */
+#define DOT_X(dot) (((dot) - 1) % 3)
+#define DOT_Y(dot) (((dot) - 1) / 3)
+
+/* Bounded min heap of one thread, the worst kept entry at the root */
+struct topk_heap {
+    struct topk_entry *entries;
+    size_t count;
+    unsigned long scored;
+    unsigned long rejected;
+};
+
+/* Shared state of the selection workers */
+struct topk_select {
+    const struct transition_table *transitions;
+    const struct topk_query *query;
+    struct topk_heap heaps[MAX_THREADS];
+    int next_shard;
+    int threshold;
+};
+
+/* Per shard state of the enumeration callback */
+struct topk_visit {
+    struct topk_select *select;
+    struct topk_heap *heap;
+};
+
+/*
+ * Orientation of three dots: 1 counterclockwise, -1 clockwise, 0 collinear
+ */
+static int orientation(const int a, const int b, const int c)
+{
+    int cross = (DOT_X(b) - DOT_X(a)) * (DOT_Y(c) - DOT_Y(a)) -
+                (DOT_Y(b) - DOT_Y(a)) * (DOT_X(c) - DOT_X(a));
+
+    return (cross > 0) - (cross < 0);
+}
+
+/*
+ * Number of pairs of strokes crossing each other
+ */
+static int crossing_score(const packed_pattern_t pattern)
+{
+    int len = packed_length(pattern);
+    int crossings = 0;
+    int i, j;
+
+    for (i = 0; i + 1 < len; i++) {
+        int a = PACKED_DOT(pattern, i);
+        int b = PACKED_DOT(pattern, i + 1);
+
+        /* neighbouring strokes share a dot, they can not cross */
+        for (j = i + 2; j + 1 < len; j++) {
+            int c = PACKED_DOT(pattern, j);
+            int d = PACKED_DOT(pattern, j + 1);
+
+            if (orientation(a, b, c) * orientation(a, b, d) < 0 &&
+                orientation(c, d, a) * orientation(c, d, b) < 0)
+            {
+                crossings++;
+            }
+        }
+    }
+
+    return crossings;
+}
+
+/*
+ * Area of the bounding box of the pattern, in dot spacings squared
+ */
+static int area_score(const packed_pattern_t pattern)
+{
+    int min_x = 2, max_x = 0, min_y = 2, max_y = 0;
+    packed_pattern_t p;
+
+    for (p = pattern; p != 0; p >>= 4) {
+        int dot = (int)(p & 0xf);
+
+        min_x = DOT_X(dot) < min_x ? DOT_X(dot) : min_x;
+        max_x = DOT_X(dot) > max_x ? DOT_X(dot) : max_x;
+        min_y = DOT_Y(dot) < min_y ? DOT_Y(dot) : min_y;
+        max_y = DOT_Y(dot) > max_y ? DOT_Y(dot) : max_y;
+    }
+
+    return (max_x - min_x) * (max_y - min_y);
+}
+
+static const struct pattern_scorer pattern_scorers[] = {
+    { "score", pattern_score },
+    { "crossings", crossing_score },
+    { "area", area_score },
+};
+
+/*
+ * Look up a scoring function by name
+ *
+ * \param name name of the scorer (score, crossings or area)
+ * \return scoring function, NULL if unknown
+ */
+const struct pattern_scorer *find_pattern_scorer(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(pattern_scorers) / sizeof(pattern_scorers[0]);
+         i++)
+    {
+        if (strcmp(pattern_scorers[i].name, name) == 0) {
+            return &pattern_scorers[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Pattern with the first dot in the highest digit, so patterns compare in
+ * lexicographic order
+ */
+static packed_pattern_t lexicographic_key(const packed_pattern_t pattern)
+{
+    packed_pattern_t key = 0;
+    packed_pattern_t p = pattern;
+    int i;
+
+    for (i = 0; i < MAX_POINTS; i++, p >>= 4) {
+        key = (key << 4) | (p & 0xf);
+    }
+
+    return key;
+}
+
+/*
+ * Check whether an entry is better than another one
+ */
+static int entry_better(const struct topk_entry *a,
+                        const struct topk_entry *b)
+{
+    if (a->score != b->score) {
+        return a->score > b->score;
+    }
+
+    return lexicographic_key(a->pattern) < lexicographic_key(b->pattern);
+}
+
+/*
+ * Replace the root of a full heap and restore the heap order
+ */
+static void heap_replace_root(struct topk_heap *heap,
+                              const struct topk_entry *entry)
+{
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count &&
+            entry_better(&heap->entries[child], &heap->entries[child + 1]))
+        {
+            child++;
+        }
+        if (entry_better(&heap->entries[child], entry)) {
+            break;
+        }
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = *entry;
+
+    return;
+}
+
+/*
+ * Add an entry to a heap which is not full yet
+ */
+static void heap_push(struct topk_heap *heap, const struct topk_entry *entry)
+{
+    size_t i = heap->count++;
+
+    while (i > 0 && entry_better(&heap->entries[(i - 1) / 2], entry)) {
+        heap->entries[i] = heap->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->entries[i] = *entry;
+
+    return;
+}
+
+/*
+ * Raise the shared threshold to the k-th best score of a thread
+ */
+static void raise_threshold(struct topk_select *select, const int score)
+{
+    int current = __atomic_load_n(&select->threshold, __ATOMIC_RELAXED);
+
+    /* a failed exchange reloads current */
+    while (score > current &&
+           __atomic_compare_exchange_n(&select->threshold, &current, score,
+                                       0, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED) == 0)
+    {
+        ;
+    }
+
+    return;
+}
+
+/*
+ * Score one enumerated pattern
+ */
+static void topk_visit_pattern(void *ctx, const packed_pattern_t pattern,
+                               const unsigned int used_mask)
+{
+    struct topk_visit *visit = ctx;
+    struct topk_select *select = visit->select;
+    struct topk_heap *heap = visit->heap;
+    size_t k = select->query->k;
+    struct topk_entry entry;
+
+    (void)used_mask;
+
+    if (pattern_filter_match(select->query->filter, pattern) == 0) {
+        return;
+    }
+
+    entry.score = select->query->scorer->score(pattern);
+    entry.pattern = pattern;
+    heap->scored++;
+
+    if (entry.score < __atomic_load_n(&select->threshold, __ATOMIC_RELAXED)) {
+        heap->rejected++;
+        return;
+    }
+
+    if (heap->count < k) {
+        heap_push(heap, &entry);
+    } else if (entry_better(&entry, &heap->entries[0])) {
+        heap_replace_root(heap, &entry);
+    } else {
+        heap->rejected++;
+        return;
+    }
+
+    if (heap->count == k) {
+        raise_threshold(select, heap->entries[0].score);
+    }
+
+    return;
+}
+
+/*
+ * Worker scoring the prefix shards it claims
+ */
+static void topk_worker(void *ctx, const int thread_index)
+{
+    struct topk_select *select = ctx;
+    const struct transition_table *t = select->transitions;
+    struct topk_visit visit;
+    int shard;
+
+    visit.select = select;
+    visit.heap = &select->heaps[thread_index];
+
+    while ((shard = __sync_fetch_and_add(&select->next_shard, 1)) <
+           TABLE_SHARDS)
+    {
+        int first = shard / MAX_POINTS + 1;
+        int second = shard % MAX_POINTS + 1;
+
+        if ((t->next[0][0] & DOT_BIT(first)) == 0) {
+            continue;
+        }
+        if (first == second) {
+            topk_visit_pattern(&visit, (packed_pattern_t)first,
+                               DOT_BIT(first));
+        } else if (t->next[DOT_BIT(first)][first] & DOT_BIT(second)) {
+            enumerate_from(t, (packed_pattern_t)(first | (second << 4)),
+                           select->query->filter->max_length,
+                           topk_visit_pattern, &visit);
+        }
+    }
+
+    return;
+}
+
+/*
+ * Best first order of entries for qsort()
+ */
+static int compare_entries(const void *a, const void *b)
+{
+    const struct topk_entry *x = a;
+    const struct topk_entry *y = b;
+
+    if (entry_better(x, y)) {
+        return -1;
+    }
+
+    return entry_better(y, x);
+}
+
+/*
+ * Select the k best patterns matching a filter
+ *
+ * \param block_matrix transition matrix to use
+ * \param query scorer, filter, k and threads of the selection, gets the
+ *        selected entries
+ * \return returns 0 on success, -1 if out of memory or k entries per
+ *         thread do not fit in memory
+ */
+int select_top_patterns(int block_matrix[][10], struct topk_query *query)
+{
+    struct transition_table *transitions;
+    struct topk_select *select;
+    struct topk_entry *merged;
+    int thread_count = query->thread_count < 1 ? 1 :
+                       query->thread_count > MAX_THREADS ? MAX_THREADS :
+                       query->thread_count;
+    size_t count = 0;
+    int t;
+
+    query->entries = NULL;
+    query->count = 0;
+    query->scored = 0;
+    query->rejected = 0;
+    if (query->k == 0) {
+        return 0;
+    }
+    if (query->k > SIZE_MAX / sizeof(struct topk_entry) / thread_count) {
+        return -1;
+    }
+
+    transitions = malloc(sizeof(struct transition_table));
+    select = calloc(1, sizeof(struct topk_select));
+    merged = malloc(query->k * thread_count * sizeof(struct topk_entry));
+    if (transitions == NULL || select == NULL || merged == NULL) {
+        free(transitions);
+        free(select);
+        free(merged);
+        return -1;
+    }
+    build_transition_table(block_matrix, transitions);
+
+    /* the heaps are slices of the merge buffer */
+    for (t = 0; t < thread_count; t++) {
+        select->heaps[t].entries = merged + query->k * t;
+    }
+    select->transitions = transitions;
+    select->query = query;
+    select->next_shard = 0;
+    __atomic_store_n(&select->threshold, INT_MIN, __ATOMIC_RELAXED);
+
+    run_parallel(thread_count, topk_worker, select);
+
+    for (t = 0; t < thread_count; t++) {
+        memmove(merged + count, select->heaps[t].entries,
+                select->heaps[t].count * sizeof(struct topk_entry));
+        count += select->heaps[t].count;
+        query->scored += select->heaps[t].scored;
+        query->rejected += select->heaps[t].rejected;
+    }
+    qsort(merged, count, sizeof(struct topk_entry), compare_entries);
+
+    query->entries = merged;
+    query->count = count < query->k ? count : query->k;
+
+    free(transitions);
+    free(select);
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Parallel selection of the best patterns under any scoring function.
+ */
+
+#ifndef AUPATTERNS_TOPK_H
+#define AUPATTERNS_TOPK_H
+
+#include <stddef.h>
+
+#include "pattern.h"
+
+/* A scoring function, higher scores are better */
+struct pattern_scorer {
+    const char *name;
+    int (*score)(const packed_pattern_t pattern);
+};
+
+/* A selected pattern with its score */
+struct topk_entry {
+    int score;
+    packed_pattern_t pattern;
+};
+
+/*
+ * Selection of the k best patterns matching a filter. Ties are broken by
+ * the lexicographic order of the patterns. The k entries (or fewer if not
+ * enough patterns match) come out best first and must be freed with free().
+ */
+struct topk_query {
+    const struct pattern_scorer *scorer;
+    const struct pattern_filter *filter;
+    size_t k;
+    int thread_count;
+    struct topk_entry *entries;
+    size_t count;
+    unsigned long scored;
+    unsigned long rejected;
+};
+
+const struct pattern_scorer *find_pattern_scorer(const char *name);
+int select_top_patterns(int block_matrix[][10], struct topk_query *query);
+
+#endif
@@ -0,0 +1,407 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Single pass visitor pipeline over the pattern space.
+ *
+ * Counting, writing, hashing and statistics are registered as visitors of
+ * one enumeration, so a combined job walks the pattern space once. Patterns
+ * are handed over in batches to keep the per pattern call overhead low.
+ *
+ * The enumeration follows the order of the original pattern tree output:
+ * every node lists all of its children first and then descends into them
+ * one by one. If the pipeline has a hash, the hash states of the listed
+ * children are kept until they are descended into, so each pattern costs a
+ * single byte of hashing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "probes.h"
+#include "visitor.h"
+
+/* State of one enumeration pass */
+struct pipeline_walk {
+    struct visitor_pipeline *pipeline;
+    const struct transition_table *table;
+    struct pattern_batch *batch;
+    uint64_t states[MAX_POINTS + 1][MAX_POINTS]
+                   [MAX_HASH_STATE / sizeof(uint64_t)];
+};
+
+/*
+ * Initialize an empty pipeline without hashing
+ *
+ * \param pipeline pipeline to initialize
+ */
+void init_visitor_pipeline(struct visitor_pipeline *pipeline)
+{
+    pipeline->count = 0;
+    pipeline->hash = NULL;
+    pipeline->salt = NULL;
+    pipeline->salt_len = 0;
+
+    return;
+}
+
+/*
+ * Register a visitor
+ *
+ * \param pipeline pipeline to add to
+ * \param visitor visitor to add, copied into the pipeline
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_pattern_visitor(struct visitor_pipeline *pipeline,
+                        const struct pattern_visitor *visitor)
+{
+    if (pipeline->count >= MAX_VISITORS) {
+        return -1;
+    }
+
+    pipeline->visitors[pipeline->count++] = *visitor;
+
+    return 0;
+}
+
+/*
+ * Hand the current batch to every visitor and empty it
+ */
+static void flush_batch(struct pipeline_walk *walk)
+{
+    struct visitor_pipeline *pipeline = walk->pipeline;
+    int i;
+
+    if (walk->batch->count == 0) {
+        return;
+    }
+
+    for (i = 0; i < pipeline->count; i++) {
+        pipeline->visitors[i].visit_batch(pipeline->visitors[i].ctx,
+                                          walk->batch);
+    }
+    walk->batch->count = 0;
+
+    return;
+}
+
+/*
+ * Walk the subtree of a state in pattern tree output order
+ */
+static void walk_subtree(struct pipeline_walk *walk,
+                         const packed_pattern_t pattern,
+                         const unsigned int mask, const int last,
+                         const int depth, const uint64_t *state)
+{
+    const struct pattern_hash *hash = walk->pipeline->hash;
+    struct pattern_batch *batch = walk->batch;
+    uint16_t candidates = walk->table->next[mask][last];
+    uint16_t children;
+
+    /* list all children first */
+    for (children = candidates; children != 0; children &= children - 1) {
+        int next = __builtin_ctz(children) + 1;
+        size_t row = batch->count;
+
+        batch->patterns[row] = pattern |
+                               (packed_pattern_t)next << (4 * depth);
+        batch->used[row] = (uint16_t)(mask | DOT_BIT(next));
+        if (hash != NULL) {
+            uint64_t *child = walk->states[depth + 1][next - 1];
+            unsigned char byte = (unsigned char)(next - 1);
+
+            memcpy(child, state, hash->state_size);
+            hash->update(child, &byte, 1);
+            hash->final(child, batch->digests[row]);
+        }
+
+        if (++batch->count == PATTERN_BATCH_SIZE) {
+            flush_batch(walk);
+        }
+    }
+
+    /* then descend into them */
+    for (children = candidates; children != 0; children &= children - 1) {
+        int next = __builtin_ctz(children) + 1;
+
+        walk_subtree(walk, pattern | (packed_pattern_t)next << (4 * depth),
+                     mask | DOT_BIT(next), next, depth + 1,
+                     walk->states[depth + 1][next - 1]);
+    }
+
+    return;
+}
+
+/*
+ * Finish every visitor of the pipeline, which joins their threads and
+ * releases their resources. Also used when the pipeline is not run.
+ *
+ * \param pipeline pipeline to finish
+ */
+void finish_visitor_pipeline(struct visitor_pipeline *pipeline)
+{
+    int i;
+
+    for (i = 0; i < pipeline->count; i++) {
+        if (pipeline->visitors[i].finish != NULL) {
+            pipeline->visitors[i].finish(pipeline->visitors[i].ctx);
+        }
+    }
+
+    return;
+}
+
+/*
+ * Enumerate every pattern once and feed all visitors of the pipeline. The
+ * visitors are finished even if the pass fails.
+ *
+ * \param pipeline pipeline to run
+ * \param table legal transitions to follow
+ * \param arena scratch arena to take the walk state and batch from
+ * \return returns 0 on success, -1 if out of memory
+ */
+int run_visitor_pipeline(struct visitor_pipeline *pipeline,
+                         const struct transition_table *table,
+                         struct scratch_arena *arena)
+{
+    struct pipeline_walk *walk;
+
+    walk = arena_alloc(arena, sizeof(struct pipeline_walk));
+    if (walk == NULL) {
+        finish_visitor_pipeline(pipeline);
+        return -1;
+    }
+    walk->batch = arena_alloc(arena, sizeof(struct pattern_batch));
+    if (walk->batch == NULL) {
+        finish_visitor_pipeline(pipeline);
+        return -1;
+    }
+
+    walk->pipeline = pipeline;
+    walk->table = table;
+    walk->batch->count = 0;
+    walk->batch->digest_size = 0;
+
+    /* the salt is absorbed once into the root state */
+    if (pipeline->hash != NULL) {
+        walk->batch->digest_size = pipeline->hash->digest_size;
+        pipeline->hash->init(walk->states[0][0]);
+        pipeline->hash->update(walk->states[0][0], pipeline->salt,
+                               pipeline->salt_len);
+    }
+
+    AUP_PROBE1(enumerate_start, pipeline->count);
+    walk_subtree(walk, 0, 0, 0, 0, walk->states[0][0]);
+    flush_batch(walk);
+    finish_visitor_pipeline(pipeline);
+
+    AUP_PROBE1(enumerate_end, pipeline->count);
+
+    return 0;
+}
+
+static void count_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct pattern_counter *counter = ctx;
+    size_t i;
+
+    for (i = 0; i < batch->count; i++) {
+        counter->pattern_count[popcount_mask(batch->used[i]) - 1]++;
+    }
+
+    return;
+}
+
+/*
+ * Register a visitor counting the patterns of every length
+ *
+ * \param pipeline pipeline to add to
+ * \param counter counts to fill, reset here
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_pattern_counter(struct visitor_pipeline *pipeline,
+                        struct pattern_counter *counter)
+{
+    struct pattern_visitor visitor;
+    int i;
+
+    for (i = 0; i < MAX_POINTS; i++) {
+        counter->pattern_count[i] = 0;
+    }
+
+    visitor.visit_batch = count_batch;
+    visitor.finish = NULL;
+    visitor.ctx = counter;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
+
+/*
+ * Format the patterns of a batch (and their digests) as text lines
+ *
+ * \param batch patterns to format
+ * \param filter only patterns matching the filter are formatted
+ * \param buffer buffer of at least FORMATTED_BATCH_SIZE characters
+ * \return number of characters written
+ */
+size_t format_pattern_batch(const struct pattern_batch *batch,
+                            const struct pattern_filter *filter,
+                            char *buffer)
+{
+    size_t len = 0;
+    size_t i;
+
+    for (i = 0; i < batch->count; i++) {
+        if (pattern_filter_match(filter, batch->patterns[i])) {
+            len += format_pattern_line(batch, i, buffer + len);
+        }
+    }
+
+    return len;
+}
+
+/*
+ * Format one pattern of a batch (and its digest) as a text line
+ *
+ * \param batch batch holding the pattern
+ * \param row index of the pattern in the batch
+ * \param buffer buffer of at least FORMATTED_LINE_SIZE characters
+ * \return number of characters written
+ */
+size_t format_pattern_line(const struct pattern_batch *batch,
+                           const size_t row, char *buffer)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t len;
+    int j;
+
+    len = packed_to_string(batch->patterns[row], buffer);
+    if (batch->digest_size > 0) {
+        buffer[len++] = ' ';
+        for (j = 0; j < batch->digest_size; j++) {
+            buffer[len++] = hex[batch->digests[row][j] >> 4];
+            buffer[len++] = hex[batch->digests[row][j] & 0xf];
+        }
+    }
+    buffer[len++] = '\n';
+
+    return len;
+}
+
+static void write_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct pattern_writer *writer = ctx;
+    char buffer[FORMATTED_BATCH_SIZE];
+    size_t len;
+
+    len = format_pattern_batch(batch, writer->filter, buffer);
+    fwrite(buffer, 1, len, writer->output_file);
+    AUP_PROBE1(output_flush, len);
+
+    return;
+}
+
+/*
+ * Register a visitor writing the patterns (and digests) to a file
+ *
+ * \param pipeline pipeline to add to
+ * \param writer output file and filter of the patterns to write
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_pattern_writer(struct visitor_pipeline *pipeline,
+                       struct pattern_writer *writer)
+{
+    struct pattern_visitor visitor;
+
+    visitor.visit_batch = write_batch;
+    visitor.finish = NULL;
+    visitor.ctx = writer;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
+
+static void score_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct score_histogram *histogram = ctx;
+    size_t i;
+
+    for (i = 0; i < batch->count; i++) {
+        if (pattern_filter_match(histogram->filter, batch->patterns[i])) {
+            histogram->count[pattern_score(batch->patterns[i])]++;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Register a visitor counting the patterns of every score
+ *
+ * \param pipeline pipeline to add to
+ * \param histogram histogram to fill, reset here except for the filter
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_score_histogram(struct visitor_pipeline *pipeline,
+                        struct score_histogram *histogram)
+{
+    struct pattern_visitor visitor;
+
+    memset(histogram->count, 0, sizeof(histogram->count));
+
+    visitor.visit_batch = score_batch;
+    visitor.finish = NULL;
+    visitor.ctx = histogram;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
+
+static void feature_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct feature_histogram *histogram = ctx;
+    size_t i;
+    int dot;
+
+    for (i = 0; i < batch->count; i++) {
+        packed_pattern_t pattern = batch->patterns[i];
+
+        if (pattern_filter_match(histogram->filter, pattern) == 0) {
+            continue;
+        }
+        histogram->patterns++;
+        histogram->start[PACKED_DOT(pattern, 0)]++;
+        histogram->end[PACKED_DOT(pattern, packed_length(pattern) - 1)]++;
+        for (dot = 1; dot <= MAX_POINTS; dot++) {
+            histogram->used[dot] += (batch->used[i] >> (dot - 1)) & 1;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Register a visitor counting start, end and used dots
+ *
+ * \param pipeline pipeline to add to
+ * \param histogram histogram to fill, reset here except for the filter
+ * \return returns 0 on success, -1 if the pipeline is full
+ */
+int add_feature_histogram(struct visitor_pipeline *pipeline,
+                          struct feature_histogram *histogram)
+{
+    struct pattern_visitor visitor;
+
+    histogram->patterns = 0;
+    memset(histogram->start, 0, sizeof(histogram->start));
+    memset(histogram->end, 0, sizeof(histogram->end));
+    memset(histogram->used, 0, sizeof(histogram->used));
+
+    visitor.visit_batch = feature_batch;
+    visitor.finish = NULL;
+    visitor.ctx = histogram;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
@@ -0,0 +1,107 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Single pass visitor pipeline over the pattern space.
+ */
+
+#ifndef AUPATTERNS_VISITOR_H
+#define AUPATTERNS_VISITOR_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "hash.h"
+#include "pattern.h"
+#include "score.h"
+
+/* Number of patterns handed to the visitors at once */
+#define PATTERN_BATCH_SIZE 1024
+
+/* Size of the text of one formatted pattern with its digest */
+#define FORMATTED_LINE_SIZE (MAX_POINTS + 2 * MAX_HASH_DIGEST + 2)
+
+/* Size of the text of a fully formatted batch */
+#define FORMATTED_BATCH_SIZE (PATTERN_BATCH_SIZE * FORMATTED_LINE_SIZE)
+
+/* Maximum number of visitors in a pipeline */
+#define MAX_VISITORS 8
+
+/* Patterns emitted by the enumeration, digests only if hashing */
+struct pattern_batch {
+    size_t count;
+    int digest_size;
+    packed_pattern_t patterns[PATTERN_BATCH_SIZE];
+    uint16_t used[PATTERN_BATCH_SIZE];
+    unsigned char digests[PATTERN_BATCH_SIZE][MAX_HASH_DIGEST];
+};
+
+/* A consumer of pattern batches, finish may be NULL */
+struct pattern_visitor {
+    void (*visit_batch)(void *ctx, const struct pattern_batch *batch);
+    void (*finish)(void *ctx);
+    void *ctx;
+};
+
+/* Visitors fed by one enumeration pass */
+struct visitor_pipeline {
+    int count;
+    struct pattern_visitor visitors[MAX_VISITORS];
+    const struct pattern_hash *hash;
+    const unsigned char *salt;
+    size_t salt_len;
+};
+
+/* Number of patterns of every length */
+struct pattern_counter {
+    int pattern_count[MAX_POINTS];
+};
+
+/* Text output of the patterns, with digests if the pipeline hashes */
+struct pattern_writer {
+    FILE *output_file;
+    const struct pattern_filter *filter;
+};
+
+/* Number of patterns of every score */
+struct score_histogram {
+    const struct pattern_filter *filter;
+    size_t count[MAX_SCORE + 1];
+};
+
+/* Number of patterns starting, ending at and using every dot */
+struct feature_histogram {
+    const struct pattern_filter *filter;
+    size_t patterns;
+    size_t start[MAX_POINTS + 1];
+    size_t end[MAX_POINTS + 1];
+    size_t used[MAX_POINTS + 1];
+};
+
+void init_visitor_pipeline(struct visitor_pipeline *pipeline);
+int add_pattern_visitor(struct visitor_pipeline *pipeline,
+                        const struct pattern_visitor *visitor);
+int run_visitor_pipeline(struct visitor_pipeline *pipeline,
+                         const struct transition_table *table,
+                         struct scratch_arena *arena);
+void finish_visitor_pipeline(struct visitor_pipeline *pipeline);
+size_t format_pattern_batch(const struct pattern_batch *batch,
+                            const struct pattern_filter *filter,
+                            char *buffer);
+size_t format_pattern_line(const struct pattern_batch *batch,
+                           const size_t row, char *buffer);
+int add_pattern_counter(struct visitor_pipeline *pipeline,
+                        struct pattern_counter *counter);
+int add_pattern_writer(struct visitor_pipeline *pipeline,
+                       struct pattern_writer *writer);
+int add_score_histogram(struct visitor_pipeline *pipeline,
+                        struct score_histogram *histogram);
+int add_feature_histogram(struct visitor_pipeline *pipeline,
+                          struct feature_histogram *histogram);
+
+#endif
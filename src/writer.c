@@ -0,0 +1,176 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern writer with formatting and I/O on their own threads.
+ *
+ * The stages are connected by bounded single producer, single consumer
+ * rings, so the enumeration only waits when the writing falls more than
+ * WRITER_QUEUE_DEPTH batches behind. Each stage runs on a named thread
+ * (aup-format, aup-io), so they show up separately in profilers.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "probes.h"
+#include "writer.h"
+
+/* End of stream marker on the queues */
+#define END_OF_STREAM NULL
+
+/*
+ * Formatting stage: pattern batches in, text blocks out
+ */
+static void *format_main(void *arg)
+{
+    struct threaded_writer *writer = arg;
+    struct pattern_batch *batch;
+    struct text_block *block;
+
+    while ((batch = spsc_pop(&writer->batches)) != END_OF_STREAM) {
+        block = spsc_pop(&writer->free_blocks);
+        block->len = format_pattern_batch(batch, writer->filter,
+                                          block->text);
+        spsc_push(&writer->free_batches, batch);
+        spsc_push(&writer->blocks, block);
+    }
+    spsc_push(&writer->blocks, END_OF_STREAM);
+
+    return NULL;
+}
+
+/*
+ * I/O stage: text blocks in, file out
+ */
+static void *io_main(void *arg)
+{
+    struct threaded_writer *writer = arg;
+    struct text_block *block;
+
+    while ((block = spsc_pop(&writer->blocks)) != END_OF_STREAM) {
+        fwrite(block->text, 1, block->len, writer->output_file);
+        AUP_PROBE1(output_flush, block->len);
+        spsc_push(&writer->free_blocks, block);
+    }
+
+    return NULL;
+}
+
+/*
+ * Enumeration side: copy the batch into a free one and queue it
+ */
+static void threaded_write_batch(void *ctx, const struct pattern_batch *batch)
+{
+    struct threaded_writer *writer = ctx;
+    struct pattern_batch *copy;
+
+    copy = spsc_pop(&writer->free_batches);
+    copy->count = batch->count;
+    copy->digest_size = batch->digest_size;
+    memcpy(copy->patterns, batch->patterns,
+           batch->count * sizeof(packed_pattern_t));
+    if (batch->digest_size > 0) {
+        memcpy(copy->digests, batch->digests,
+               batch->count * sizeof(batch->digests[0]));
+    }
+    spsc_push(&writer->batches, copy);
+
+    return;
+}
+
+/*
+ * Release the queues and buffers of a writer
+ */
+static void free_threaded_writer(struct threaded_writer *writer)
+{
+    spsc_free(&writer->batches);
+    spsc_free(&writer->free_batches);
+    spsc_free(&writer->blocks);
+    spsc_free(&writer->free_blocks);
+    free(writer->batch_pool);
+    free(writer->block_pool);
+
+    return;
+}
+
+/*
+ * Drain the stages and stop the threads at the end of the pass
+ */
+static void threaded_write_finish(void *ctx)
+{
+    struct threaded_writer *writer = ctx;
+
+    spsc_push(&writer->batches, END_OF_STREAM);
+    pthread_join(writer->format_thread, NULL);
+    pthread_join(writer->io_thread, NULL);
+    free_threaded_writer(writer);
+
+    return;
+}
+
+/*
+ * Register a writer running formatting and I/O on separate threads. The
+ * threads are started here and stopped when the pipeline finishes.
+ *
+ * \param pipeline pipeline to add to
+ * \param writer output file and filter of the patterns to write
+ * \return returns 0 on success, -1 if the writer could not be started
+ */
+int add_threaded_writer(struct visitor_pipeline *pipeline,
+                        struct threaded_writer *writer)
+{
+    struct pattern_visitor visitor;
+    int i;
+
+    writer->batches.slots = NULL;
+    writer->free_batches.slots = NULL;
+    writer->blocks.slots = NULL;
+    writer->free_blocks.slots = NULL;
+    writer->batch_pool = malloc(WRITER_QUEUE_DEPTH *
+                                sizeof(struct pattern_batch));
+    writer->block_pool = malloc(WRITER_QUEUE_DEPTH *
+                                sizeof(struct text_block));
+    if (spsc_init(&writer->batches, WRITER_QUEUE_DEPTH + 1) < 0 ||
+        spsc_init(&writer->free_batches, WRITER_QUEUE_DEPTH) < 0 ||
+        spsc_init(&writer->blocks, WRITER_QUEUE_DEPTH + 1) < 0 ||
+        spsc_init(&writer->free_blocks, WRITER_QUEUE_DEPTH) < 0 ||
+        writer->batch_pool == NULL || writer->block_pool == NULL ||
+        pipeline->count >= MAX_VISITORS)
+    {
+        free_threaded_writer(writer);
+        return -1;
+    }
+
+    for (i = 0; i < WRITER_QUEUE_DEPTH; i++) {
+        spsc_push(&writer->free_batches, &writer->batch_pool[i]);
+        spsc_push(&writer->free_blocks, &writer->block_pool[i]);
+    }
+
+    if (pthread_create(&writer->format_thread, NULL, format_main,
+                       writer) != 0)
+    {
+        free_threaded_writer(writer);
+        return -1;
+    }
+    if (pthread_create(&writer->io_thread, NULL, io_main, writer) != 0) {
+        spsc_push(&writer->batches, END_OF_STREAM);
+        pthread_join(writer->format_thread, NULL);
+        free_threaded_writer(writer);
+        return -1;
+    }
+    pthread_setname_np(writer->format_thread, "aup-format");
+    pthread_setname_np(writer->io_thread, "aup-io");
+
+    visitor.visit_batch = threaded_write_batch;
+    visitor.finish = threaded_write_finish;
+    visitor.ctx = writer;
+
+    return add_pattern_visitor(pipeline, &visitor);
+}
@@ -0,0 +1,51 @@
+/*
+ * Android unlock pattern calculator.
+ * Copyright (c) 2011  Zoltan Puskas
+ * All rights reserved.
+ *
+ * This program is free software and redistributred under the 3-clause BSD
+ * license. For details see attached license file COPYING
+ *
+ * Pattern writer with formatting and I/O on their own threads.
+ */
+
+#ifndef AUPATTERNS_WRITER_H
+#define AUPATTERNS_WRITER_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "spsc.h"
+#include "visitor.h"
+
+/* Number of batches in flight between two stages */
+#define WRITER_QUEUE_DEPTH 8
+
+/* A block of formatted text */
+struct text_block {
+    size_t len;
+    char text[FORMATTED_BATCH_SIZE];
+};
+
+/*
+ * Three stage writer: the enumeration thread copies batches into the pattern
+ * queue, the formatting thread turns them into text blocks and the I/O
+ * thread writes the blocks. Used buffers travel back on the free queues.
+ */
+struct threaded_writer {
+    FILE *output_file;
+    const struct pattern_filter *filter;
+    struct spsc_ring batches;
+    struct spsc_ring free_batches;
+    struct spsc_ring blocks;
+    struct spsc_ring free_blocks;
+    struct pattern_batch *batch_pool;
+    struct text_block *block_pool;
+    pthread_t format_thread;
+    pthread_t io_thread;
+};
+
+int add_threaded_writer(struct visitor_pipeline *pipeline,
+                        struct threaded_writer *writer);
+
+#endif